@@ -0,0 +1,147 @@
+/*
+ * arenabench.c - cost of mm_arena_alloc against mm_malloc (see mm.h)
+ *
+ * For each count, arenabench times a round of that many small blocks
+ * (16 to 79 bytes) taken from a bump arena and dropped with one
+ * mm_arena_reset, and a round of the same blocks taken with mm_malloc
+ * and given back one by one with mm_free. Each figure is the median of
+ * -n timed rounds, in ns per block, on a fresh heap of the mm.c engine
+ * it is linked with. The arena keeps its first chunk across rounds, as
+ * it would in a program that resets it per request or per frame.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+#define MAXCOUNTS 32
+
+static int reps = 21;   /* timed rounds per figure (-n) */
+
+/*
+ * app_error - report an error and exit
+ */
+static void app_error(char *msg)
+{
+    fprintf(stderr, "arenabench: %s\n", msg);
+    exit(1);
+}
+
+/*
+ * now - monotonic time in seconds
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * cmp_double - qsort comparator for doubles
+ */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * bench - median ns per block of a round of count blocks, from an
+ *     arena (arena = 1) or from mm_malloc/mm_free (arena = 0)
+ */
+static double bench(int arena, void **blocks, int count)
+{
+    mm_arena_t *a = NULL;
+    double *t, start, ns;
+    int i, k;
+
+    if ((t = malloc(reps * sizeof(double))) == NULL)
+	app_error("out of memory");
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed");
+    if (arena && (a = mm_arena_create(0)) == NULL)
+	app_error("mm_arena_create failed");
+    for (i = -1; i < reps; i++) {  /* one warm-up round */
+	start = now();
+	if (arena) {
+	    for (k = 0; k < count; k++)
+		if ((blocks[k] = mm_arena_alloc(a, 16 + (k & 63))) == NULL)
+		    app_error("mm_arena_alloc failed");
+	    mm_arena_reset(a);
+	} else {
+	    for (k = 0; k < count; k++)
+		if ((blocks[k] = mm_malloc(16 + (k & 63))) == NULL)
+		    app_error("mm_malloc failed");
+	    for (k = 0; k < count; k++)
+		mm_free(blocks[k]);
+	}
+	if (i >= 0)
+	    t[i] = now() - start;
+    }
+    if (arena)
+	mm_arena_destroy(a);
+    qsort(t, reps, sizeof(double), cmp_double);
+    ns = t[reps / 2] / count * 1e9;
+    free(t);
+    return ns;
+}
+
+/*
+ * usage - explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: arenabench [-h] [-n <reps>] [<count>...]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-n <reps>  Timed rounds per figure (default 21).\n");
+    fprintf(stderr, "Counts default to 100 1000 3000 10000.\n");
+}
+
+int main(int argc, char **argv)
+{
+    int counts[MAXCOUNTS] = {100, 1000, 3000, 10000};
+    int c, i, max = 0, ncounts = 4;
+    void **blocks;
+
+    while ((c = getopt(argc, argv, "hn:")) != EOF) {
+	switch (c) {
+	case 'n':
+	    if ((reps = atoi(optarg)) < 1)
+		app_error("-n expects a positive count");
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (optind < argc) {
+	for (ncounts = 0; optind < argc && ncounts < MAXCOUNTS; ncounts++)
+	    if ((counts[ncounts] = atoi(argv[optind++])) < 1)
+		app_error("counts are positive numbers of blocks");
+    }
+    for (i = 0; i < ncounts; i++)
+	if (counts[i] > max)
+	    max = counts[i];
+    if ((blocks = malloc(max * sizeof(void *))) == NULL)
+	app_error("out of memory");
+
+    mem_init();
+    printf("%10s %12s %12s\n", "blocks", "arena", "malloc/free");
+    for (i = 0; i < ncounts; i++)
+	printf("%10d %12.1f %12.1f\n", counts[i],
+	       bench(1, blocks, counts[i]), bench(0, blocks, counts[i]));
+    printf("(ns per block, median of %d rounds of 16-79 byte blocks)\n",
+	   reps);
+    free(blocks);
+    return 0;
+}
@@ -67,6 +67,17 @@
  *****************************************************************************/
 #define USE_FCYC   0   /* cycle counter w/K-best scheme (x86 & Alpha only) */
 #define USE_ITIMER 0   /* interval timer (any Unix box) */
-#define USE_GETTOD 1   /* gettimeofday (any Unix box) */
+#define USE_GETTOD 0   /* gettimeofday (any Unix box) */
+#define USE_ADAPT  1   /* clock_gettime w/median of adaptive runs (POSIX) */
+
+/*
+ * Parameters of the USE_ADAPT timer: the number of discarded warm-up
+ * runs, the target relative half-width of the 95% confidence interval
+ * of the median, and the caps on runs and seconds per measurement.
+ */
+#define TIMER_WARMUP   3
+#define TIMER_REL_ERR  0.01  /* 1% */
+#define TIMER_MAX_RUNS 1000
+#define TIMER_MAX_SECS 1.0
 
 #endif /* __CONFIG_H */
@@ -0,0 +1,172 @@
+/*
+ * copybench.c - copy throughput of the mem_copy paths (see memcopy.h)
+ *
+ * For each size, copybench times copies with every path the CPU
+ * supports, and with mem_copy itself, which switches from plain
+ * memmove to the widest streaming path at MEMCOPY_NT_MIN bytes. Each
+ * figure is the median of -n timed copies, in MB/s (10^6 bytes per
+ * second). Buffers are 8 bytes off a 16-byte boundary, like mm.c
+ * payloads. With -b the copy moves a block 64 bytes down onto itself,
+ * like realloc merging the previous free block; mem_copy leaves those
+ * moves to memmove.
+ *
+ * Streaming stores bypass the cache, so on sizes that fit in it they
+ * are slower than memmove; past it they are faster, and they do not
+ * evict the program's working set on the way.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "memcopy.h"
+
+#define MAXSIZES 32
+#define BACK     64     /* -b: bytes the block moves down */
+
+static int reps = 21;   /* timed copies per figure (-n) */
+static int back = 0;    /* overlapping move down (-b) */
+
+/*
+ * app_error - report an error and exit
+ */
+static void app_error(char *msg)
+{
+    fprintf(stderr, "copybench: %s\n", msg);
+    exit(1);
+}
+
+/*
+ * now - monotonic time in seconds
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * cmp_double - qsort comparator for doubles
+ */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * bench - median MB/s of copying size bytes with path (-1: mem_copy)
+ */
+static double bench(int path, char *buf, size_t size)
+{
+    double *t, start, mbs;
+    char *src = buf + 8 + (back ? BACK : 0);
+    char *dst = back ? buf + 8 : buf + 8 + size + 64;
+    int i;
+
+    if ((t = malloc(reps * sizeof(double))) == NULL)
+	app_error("out of memory");
+    for (i = -1; i < reps; i++) {  /* one warm-up copy */
+	start = now();
+	if (path < 0)
+	    mem_copy(dst, src, size);
+	else
+	    mem_copy_path(path, dst, src, size);
+	if (i >= 0)
+	    t[i] = now() - start;
+    }
+    qsort(t, reps, sizeof(double), cmp_double);
+    mbs = t[reps / 2] > 0 ? size / t[reps / 2] / 1e6 : 0;
+    free(t);
+    return mbs;
+}
+
+/*
+ * parse_size - a size in bytes, with an optional k, m or g suffix
+ */
+static size_t parse_size(char *arg)
+{
+    char *end;
+    double v = strtod(arg, &end);
+
+    switch (*end) {
+    case 'k': case 'K': v *= 1 << 10; end++; break;
+    case 'm': case 'M': v *= 1 << 20; end++; break;
+    case 'g': case 'G': v *= 1 << 30; end++; break;
+    }
+    if (*end || v < 1)
+	app_error("sizes are positive byte counts, e.g. 4096, 64k or 8m");
+    return (size_t)v;
+}
+
+/*
+ * usage - explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: copybench [-hb] [-n <reps>] [<size>...]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-b         Move each block down onto itself.\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-n <reps>  Timed copies per figure (default 21).\n");
+    fprintf(stderr, "Sizes default to 4k 64k 256k 1m 4m 16m.\n");
+}
+
+int main(int argc, char **argv)
+{
+    size_t sizes[MAXSIZES] = {4 << 10, 64 << 10, 256 << 10, 1 << 20,
+			      4 << 20, 16 << 20};
+    size_t max = 0;
+    int c, i, p, nsizes = 6;
+    char *buf;
+
+    while ((c = getopt(argc, argv, "bhn:")) != EOF) {
+	switch (c) {
+	case 'b':
+	    back = 1;
+	    break;
+	case 'n':
+	    if ((reps = atoi(optarg)) < 1)
+		app_error("-n expects a positive count");
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (optind < argc) {
+	for (nsizes = 0; optind < argc && nsizes < MAXSIZES; nsizes++)
+	    sizes[nsizes] = parse_size(argv[optind++]);
+    }
+    for (i = 0; i < nsizes; i++)
+	if (sizes[i] > max)
+	    max = sizes[i];
+    if ((buf = malloc(2 * max + 256)) == NULL)
+	app_error("out of memory");
+    memset(buf, 1, 2 * max + 256);
+
+    printf("mem_copy: %s above %d bytes%s\n",
+	   mem_copy_name(mem_copy_best()), MEMCOPY_NT_MIN,
+	   back ? "; blocks moved down onto themselves" : "");
+    printf("%10s", "size");
+    for (p = 0; p < MC_NPATHS; p++)
+	if (mem_copy_supported(p))
+	    printf(" %10s", mem_copy_name(p));
+    printf(" %10s\n", "mem_copy");
+    for (i = 0; i < nsizes; i++) {
+	printf("%10lu", (unsigned long)sizes[i]);
+	for (p = 0; p < MC_NPATHS; p++)
+	    if (mem_copy_supported(p))
+		printf(" %10.0f", bench(p, buf, sizes[i]));
+	printf(" %10.0f\n", bench(-1, buf, sizes[i]));
+    }
+    printf("(MB/s, median of %d copies)\n", reps);
+    free(buf);
+    return 0;
+}
@@ -1,7 +1,9 @@
 /****************************
  * High-level timing wrappers
  ****************************/
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <sched.h>
 #include "fsecs.h"
 #include "fcyc.h"
 #include "clock.h"
@@ -9,6 +11,8 @@
 #include "config.h"
 
 static double Mhz;  /* estimated CPU clock frequency */
+static int cpu = -1;          /* CPU to run the measurements on, or -1 */
+static double last_lo, last_hi; /* confidence interval of the last fsecs */
 
 extern int verbose; /* -v option in mdriver.c */
 
@@ -36,22 +40,79 @@ void init_fsecs(void)
 #elif USE_GETTOD
     if (verbose)
 	printf("Measuring performance with gettimeofday().\n");
+#elif USE_ADAPT
+    if (verbose)
+	printf("Measuring performance with clock_gettime() "
+	       "(median, %d warm-up runs, %.1f%% target error).\n", 
+	       TIMER_WARMUP, TIMER_REL_ERR * 100);
 #endif
 }
 
+/*
+ * set_fsecs_cpu - run the measurements of fsecs on CPU c (-1: any).
+ *     Returns -1 if the process cannot run on that CPU.
+ */
+int set_fsecs_cpu(int c)
+{
+    cpu_set_t old, set;
+
+    if (c >= 0) {
+	if (c >= CPU_SETSIZE || sched_getaffinity(0, sizeof(old), &old) < 0)
+	    return -1;
+	CPU_ZERO(&set);
+	CPU_SET(c, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) < 0)
+	    return -1;
+	sched_setaffinity(0, sizeof(old), &old);
+    }
+    cpu = c;
+    return 0;
+}
+
+/*
+ * fsecs_ci - the 95% confidence interval of the time returned by the 
+ *     last fsecs call. Timers that take no samples return [t, t].
+ */
+void fsecs_ci(double *lo, double *hi)
+{
+    *lo = last_lo;
+    *hi = last_hi;
+}
+
 /*
  * fsecs - Return the running time of a function f (in seconds)
  */
 double fsecs(fsecs_test_funct f, void *argp) 
 {
+    cpu_set_t old, set;
+    int pinned = 0;
+    double secs;
+
+    /* pin only around the measurement, so that threads started later
+       (mdriver -T) are free to run anywhere */
+    if (cpu >= 0 && sched_getaffinity(0, sizeof(old), &old) == 0) {
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pinned = (sched_setaffinity(0, sizeof(set), &set) == 0);
+    }
+
 #if USE_FCYC
-    double cycles = fcyc(f, argp);
-    return cycles/(Mhz*1e6);
+    secs = fcyc(f, argp)/(Mhz*1e6);
 #elif USE_ITIMER
-    return ftimer_itimer(f, argp, 10);
+    secs = ftimer_itimer(f, argp, 10);
 #elif USE_GETTOD
-    return ftimer_gettod(f, argp, 10);
+    secs = ftimer_gettod(f, argp, 10);
+#elif USE_ADAPT
+    secs = ftimer_adaptive(f, argp, TIMER_WARMUP, TIMER_REL_ERR, 
+			   TIMER_MAX_RUNS, TIMER_MAX_SECS, &last_lo, &last_hi);
 #endif 
+#if !USE_ADAPT
+    last_lo = last_hi = secs;
+#endif
+
+    if (pinned)
+	sched_setaffinity(0, sizeof(old), &old);
+    return secs;
 }
 
 
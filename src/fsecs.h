@@ -2,3 +2,5 @@ typedef void (*fsecs_test_funct)(void *);
 
 void init_fsecs(void);
 double fsecs(fsecs_test_funct f, void *argp);
+int set_fsecs_cpu(int c);
+void fsecs_ci(double *lo, double *hi);
@@ -7,11 +7,20 @@
  * Function timers that estimate the running time (in seconds) of a function f.
  *    ftimer_itimer: version that uses the interval timer
  *    ftimer_gettod: version that uses gettimeofday
+ *    ftimer_adaptive: version that times single runs with clock_gettime
+ *        until the median is known well enough
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
 #include <sys/time.h>
 #include "ftimer.h"
 
+/* ftimer_adaptive never stops before this many timed runs */
+#define MIN_RUNS 10
+
 /* function prototypes */
 static void init_etime(void);
 static double get_etime(void);
@@ -52,6 +61,86 @@ double ftimer_gettod(ftimer_test_funct f, void *argp, int n)
     return (1E-3*diff);
 }
 
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * ftimer_median_ci - Sort the n samples in v and return their median.
+ * The 95% confidence interval of the median is taken from the order
+ * statistics at ranks n/2 -+ 1.96*sqrt(n)/2, which holds for any 
+ * distribution of the samples. With fewer than 6 samples the interval 
+ * is [min, max].
+ */
+double ftimer_median_ci(double *v, int n, double *lo, double *hi)
+{
+    double d = 0.98 * sqrt((double)n);
+    int j, k;
+
+    qsort(v, n, sizeof(double), cmp_double);
+    j = (int)floor(n / 2.0 - d);      /* 1-based ranks */
+    k = (int)ceil(n / 2.0 + d) + 1;
+    *lo = v[j < 1 ? 0 : j - 1];
+    *hi = v[k > n ? n - 1 : k - 1];
+    return (n % 2) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+/* return the monotonic clock in seconds */
+static double mono_secs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/*
+ * ftimer_adaptive - Use clock_gettime to time single runs of f(argp).
+ * The first warmup runs are discarded. Then f runs until the 95% 
+ * confidence interval of the median is within rel_err of the median,
+ * or until max_runs runs or max_secs seconds. Return the median and
+ * store the interval in *lo and *hi.
+ */
+double ftimer_adaptive(ftimer_test_funct f, void *argp, int warmup,
+		       double rel_err, int max_runs, double max_secs,
+		       double *lo, double *hi)
+{
+    double *v, *sorted, start, t, med = 0;
+    int i, n;
+
+    if (max_runs < MIN_RUNS)
+	max_runs = MIN_RUNS;
+    v = (double *)malloc(max_runs * sizeof(double));
+    sorted = (double *)malloc(max_runs * sizeof(double));
+    if (v == NULL || sorted == NULL) {
+	fprintf(stderr, "ftimer_adaptive: malloc failed\n");
+	exit(1);
+    }
+
+    for (i = 0; i < warmup; i++) 
+	f(argp);
+
+    start = mono_secs();
+    for (n = 0; n < max_runs; ) {
+	t = mono_secs();
+	f(argp);
+	v[n++] = mono_secs() - t;
+	if (n < MIN_RUNS)
+	    continue;
+	memcpy(sorted, v, n * sizeof(double));
+	med = ftimer_median_ci(sorted, n, lo, hi);
+	if ((*hi - *lo) / 2 <= rel_err * med || 
+	    mono_secs() - start >= max_secs)
+	    break;
+    }
+
+    free(v);
+    free(sorted);
+    return med;
+}
 
 /*
  * Routines for manipulating the Unix interval timer
@@ -12,3 +12,14 @@ double ftimer_itimer(ftimer_test_funct f, void *argp, int n);
    Return the average of n runs */
 double ftimer_gettod(ftimer_test_funct f, void *argp, int n);
 
+/* Estimate the running time of f(argp) using clock_gettime: discard
+   warmup runs, then time single runs until the 95% confidence interval
+   of the median is within rel_err of it (or max_runs/max_secs is hit).
+   Return the median and store the interval in *lo, *hi */
+double ftimer_adaptive(ftimer_test_funct f, void *argp, int warmup,
+		       double rel_err, int max_runs, double max_secs,
+		       double *lo, double *hi);
+
+/* Sort the n values in v; return their median and its 95% confidence
+   interval from order statistics */
+double ftimer_median_ci(double *v, int n, double *lo, double *hi);
@@ -0,0 +1,385 @@
+/*
+ * mdcompare.c - compare two result files written by "mdriver -o <file>.csv"
+ *
+ * For every (allocator, trace file) pair found in both files, mdcompare
+ * turns the timing samples into throughputs (ops/sec) and reports
+ *   - the speedup of the new run, i.e. the ratio of median throughputs,
+ *   - a bootstrap 95% confidence interval for that ratio, and
+ *   - the two-sided Mann-Whitney U test p-value of the two sample sets.
+ * A trace is flagged as a significant slowdown when p < alpha and the
+ * whole confidence interval lies below 1. The exit status is 2 if any
+ * slowdown was flagged, so the tool can gate allocator changes. The
+ * space utilization of both runs is shown next to it, since allocator
+ * changes often trade one for the other.
+ *
+ * Take several samples per trace (mdriver -n 10 or more): with fewer
+ * than 4 samples on each side no difference can be significant at 5%.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#define MAXLINE     1024  /* max line length in a result file */
+#define MAXNAME      256  /* max allocator / trace file name length */
+#define EXACT_MAX     20  /* exact U distribution up to this sample count */
+
+/* The samples of one allocator on one trace */
+typedef struct {
+    char alloc[MAXNAME];  /* allocator name (mm, libc, ...) */
+    char file[MAXNAME];   /* trace file name */
+    double ops;           /* number of ops in the trace */
+    double util;          /* space utilization */
+    double *thr;          /* throughput of each sample (ops/sec) */
+    int n;                /* number of samples */
+    int cap;              /* allocated length of thr */
+} series_t;
+
+/* All the series of one result file */
+typedef struct {
+    series_t *s;
+    int n;
+    int cap;
+} results_t;
+
+static double alpha = 0.05;       /* significance level (-a) */
+static int resamples = 10000;     /* bootstrap resamples (-b) */
+static unsigned long long rng = 0x9e3779b97f4a7c15ULL; /* seed (-s) */
+
+/*
+ * app_error - report an error and exit
+ */
+static void app_error(char *msg, char *arg)
+{
+    fprintf(stderr, "mdcompare: %s%s\n", msg, arg ? arg : "");
+    exit(1);
+}
+
+/*
+ * find_series - return the series of (alloc, file), creating it if asked
+ */
+static series_t *find_series(results_t *r, char *alloc, char *file, int create)
+{
+    int i;
+
+    for (i = 0; i < r->n; i++)
+	if (!strcmp(r->s[i].alloc, alloc) && !strcmp(r->s[i].file, file))
+	    return &r->s[i];
+    if (!create)
+	return NULL;
+
+    if (r->n == r->cap) {
+	r->cap = r->cap ? 2 * r->cap : 16;
+	if ((r->s = realloc(r->s, r->cap * sizeof(series_t))) == NULL)
+	    app_error("out of memory", NULL);
+    }
+    memset(&r->s[r->n], 0, sizeof(series_t));
+    strncpy(r->s[r->n].alloc, alloc, MAXNAME - 1);
+    strncpy(r->s[r->n].file, file, MAXNAME - 1);
+    return &r->s[r->n++];
+}
+
+/*
+ * read_results - read a CSV result file:
+ *     allocator,trace,file,valid,ops,util,sample,secs
+ */
+static void read_results(char *path, results_t *r)
+{
+    FILE *fp;
+    char line[MAXLINE];
+    char *field[8], *p;
+    series_t *s;
+    double secs;
+    int i;
+
+    if ((fp = fopen(path, "r")) == NULL)
+	app_error("could not open ", path);
+
+    memset(r, 0, sizeof(*r));
+    while (fgets(line, MAXLINE, fp) != NULL) {
+	if (!strncmp(line, "allocator,", 10))
+	    continue; /* header */
+
+	/* split the line into its 8 fields */
+	p = line;
+	for (i = 0; i < 8 && p; i++) {
+	    field[i] = p;
+	    if ((p = strchr(p, ',')) != NULL)
+		*p++ = '\0';
+	}
+	if (i < 8)
+	    continue; /* not a result row */
+	if (atoi(field[3]) == 0)
+	    continue; /* invalid trace: no samples */
+
+	secs = atof(field[7]);
+	s = find_series(r, field[0], field[2], 1);
+	s->ops = atof(field[4]);
+	s->util = atof(field[5]);
+	if (s->n == s->cap) {
+	    s->cap = s->cap ? 2 * s->cap : 16;
+	    if ((s->thr = realloc(s->thr, s->cap * sizeof(double))) == NULL)
+		app_error("out of memory", NULL);
+	}
+	s->thr[s->n++] = secs > 0 ? s->ops / secs : 0;
+    }
+    fclose(fp);
+}
+
+/*
+ * cmp_double - qsort comparator for doubles
+ */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * median - median of n values; sorts v in place
+ */
+static double median(double *v, int n)
+{
+    qsort(v, n, sizeof(double), cmp_double);
+    return (n % 2) ? v[n/2] : (v[n/2 - 1] + v[n/2]) / 2;
+}
+
+/*
+ * random_index - uniform random integer in [0, n), xorshift64*
+ */
+static int random_index(int n)
+{
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return (int)(((rng * 0x2545F4914F6CDD1DULL) >> 33) % (unsigned)n);
+}
+
+/*
+ * bootstrap_ci - 95% percentile bootstrap interval of the ratio of the
+ *     median of b to the median of a
+ */
+static void bootstrap_ci(double *a, int na, double *b, int nb,
+			 double *lo, double *hi)
+{
+    double *ra, *rb, *ratio;
+    int i, k;
+
+    ra = malloc(na * sizeof(double));
+    rb = malloc(nb * sizeof(double));
+    ratio = malloc(resamples * sizeof(double));
+    if (!ra || !rb || !ratio)
+	app_error("out of memory", NULL);
+
+    for (k = 0; k < resamples; k++) {
+	for (i = 0; i < na; i++)
+	    ra[i] = a[random_index(na)];
+	for (i = 0; i < nb; i++)
+	    rb[i] = b[random_index(nb)];
+	ratio[k] = median(rb, nb) / median(ra, na);
+    }
+    qsort(ratio, resamples, sizeof(double), cmp_double);
+    *lo = ratio[(int)(0.025 * (resamples - 1))];
+    *hi = ratio[(int)(0.975 * (resamples - 1))];
+
+    free(ra);
+    free(rb);
+    free(ratio);
+}
+
+/*
+ * exact_u_cdf - P(U <= u) for the Mann-Whitney U statistic of samples
+ *     of size n1 and n2 without ties, from the recurrence
+ *     N(n1, n2, u) = N(n1-1, n2, u-n2) + N(n1, n2-1, u)
+ */
+static double exact_u_cdf(int n1, int n2, int u)
+{
+    int umax = n1 * n2, i, j, k;
+    double *cnt, total = 0, below = 0;
+
+    /* cnt[(i*(n2+1) + j)*(umax+1) + k] = arrangements of i and j with U=k */
+    if ((cnt = calloc((n1+1) * (n2+1) * (umax+1), sizeof(double))) == NULL)
+	app_error("out of memory", NULL);
+#define CNT(i, j, k) cnt[((i)*(n2+1) + (j))*(umax+1) + (k)]
+    for (i = 0; i <= n1; i++) {
+	for (j = 0; j <= n2; j++) {
+	    if (i == 0 || j == 0) {
+		CNT(i, j, 0) = 1;
+		continue;
+	    }
+	    for (k = 0; k <= i * j; k++)
+		CNT(i, j, k) = (k >= j ? CNT(i-1, j, k-j) : 0) + CNT(i, j-1, k);
+	}
+    }
+    for (k = 0; k <= umax; k++) {
+	total += CNT(n1, n2, k);
+	if (k <= u)
+	    below += CNT(n1, n2, k);
+    }
+#undef CNT
+    free(cnt);
+    return below / total;
+}
+
+/*
+ * mann_whitney - two-sided p-value of the Mann-Whitney U test. Uses the
+ *     exact distribution for small samples without ties, and the normal
+ *     approximation with tie and continuity corrections otherwise.
+ */
+static double mann_whitney(double *a, int na, double *b, int nb)
+{
+    int n = na + nb, i, j, k, ties = 0;
+    double *v, *rank, r1 = 0, u, mean, var, tcorr = 0, z, lo, hi;
+    int *from_a;
+
+    v = malloc(n * sizeof(double));
+    rank = malloc(n * sizeof(double));
+    from_a = malloc(n * sizeof(int));
+    if (!v || !rank || !from_a)
+	app_error("out of memory", NULL);
+
+    /* sort the pooled samples, remembering where each came from */
+    for (i = 0; i < n; i++) {
+	v[i] = i < na ? a[i] : b[i - na];
+	from_a[i] = i < na;
+    }
+    for (i = 1; i < n; i++) {
+	double x = v[i];
+	int f = from_a[i];
+	for (j = i - 1; j >= 0 && v[j] > x; j--) {
+	    v[j+1] = v[j];
+	    from_a[j+1] = from_a[j];
+	}
+	v[j+1] = x;
+	from_a[j+1] = f;
+    }
+
+    /* average ranks over runs of ties */
+    for (i = 0; i < n; i = j) {
+	for (j = i; j < n && v[j] == v[i]; j++)
+	    ;
+	for (k = i; k < j; k++)
+	    rank[k] = (i + j + 1) / 2.0;
+	if (j - i > 1) {
+	    ties = 1;
+	    tcorr += (double)(j - i) * (j - i) * (j - i) - (j - i);
+	}
+    }
+    for (i = 0; i < n; i++)
+	if (from_a[i])
+	    r1 += rank[i];
+    free(v);
+    free(rank);
+    free(from_a);
+
+    u = r1 - na * (na + 1) / 2.0;
+    if (!ties && na <= EXACT_MAX && nb <= EXACT_MAX) {
+	lo = exact_u_cdf(na, nb, (int)u);
+	hi = 1 - exact_u_cdf(na, nb, (int)u - 1);
+	return fmin(1.0, 2 * fmin(lo, hi));
+    }
+
+    mean = na * nb / 2.0;
+    var = na * nb / 12.0 * ((n + 1) - tcorr / ((double)n * (n - 1)));
+    if (var <= 0)
+	return 1.0;
+    z = (fabs(u - mean) - 0.5) / sqrt(var);
+    if (z < 0)
+	z = 0;
+    return erfc(z / sqrt(2.0));
+}
+
+/*
+ * usage - explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mdcompare [-h] [-a <alpha>] [-b <resamples>] "
+	    "[-s <seed>] <base.csv> <new.csv>\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-a <alpha>      Significance level (default 0.05).\n");
+    fprintf(stderr, "\t-b <resamples>  Bootstrap resamples (default 10000).\n");
+    fprintf(stderr, "\t-h              Print this message.\n");
+    fprintf(stderr, "\t-s <seed>       Bootstrap random seed.\n");
+}
+
+int main(int argc, char **argv)
+{
+    results_t base, cur;
+    series_t *a, *b;
+    double speedup, lo, hi, p, logsum = 0, util0 = 0, util1 = 0;
+    int c, i, compared = 0, slower = 0;
+
+    while ((c = getopt(argc, argv, "a:b:s:h")) != EOF) {
+	switch (c) {
+	case 'a':
+	    alpha = atof(optarg);
+	    break;
+	case 'b':
+	    resamples = atoi(optarg);
+	    if (resamples < 100)
+		app_error("-b expects at least 100 resamples", NULL);
+	    break;
+	case 's':
+	    rng = strtoull(optarg, NULL, 0) | 1;
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (argc - optind != 2) {
+	usage();
+	exit(1);
+    }
+
+    read_results(argv[optind], &base);
+    read_results(argv[optind + 1], &cur);
+
+    printf("%-6s %-20s %4s %4s %6s %6s %10s %10s %8s %17s %8s\n", "alloc",
+	   "trace", "n0", "n1", "util0", "util1", "base Kops", "new Kops",
+	   "speedup", "95% CI", "p");
+    for (i = 0; i < base.n; i++) {
+	a = &base.s[i];
+	if ((b = find_series(&cur, a->alloc, a->file, 0)) == NULL)
+	    continue;
+	/* the medians must come first: the bootstrap reorders samples */
+	lo = median(a->thr, a->n);
+	hi = median(b->thr, b->n);
+	speedup = hi / lo;
+	printf("%-6s %-20s %4d %4d %5.1f%% %5.1f%% %10.0f %10.0f %8.3f",
+	       a->alloc, a->file, a->n, b->n, 100 * a->util, 100 * b->util,
+	       lo / 1e3, hi / 1e3, speedup);
+
+	bootstrap_ci(a->thr, a->n, b->thr, b->n, &lo, &hi);
+	p = mann_whitney(a->thr, a->n, b->thr, b->n);
+	printf("   [%6.3f, %6.3f] %8.4f", lo, hi, p);
+	if (p < alpha && hi < 1) {
+	    printf("  SLOWER");
+	    slower++;
+	} else if (p < alpha && lo > 1) {
+	    printf("  faster");
+	}
+	printf("\n");
+
+	logsum += log(speedup);
+	util0 += a->util;
+	util1 += b->util;
+	compared++;
+    }
+
+    if (compared == 0)
+	app_error("no trace appears in both result files", NULL);
+    printf("\nGeometric mean speedup over %d traces: %.3f\n", compared,
+	   exp(logsum / compared));
+    printf("Mean utilization: %.1f%% -> %.1f%%\n", 100 * util0 / compared,
+	   100 * util1 / compared);
+    if (slower)
+	printf("%d significant slowdown%s at alpha = %g\n", slower,
+	       slower > 1 ? "s" : "", alpha);
+    exit(slower ? 2 : 0);
+}
@@ -14,11 +14,22 @@
 #include <string.h>
 #include <assert.h>
 #include <float.h>
+#include <stddef.h>
 #include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <dlfcn.h>
 
 #include "mm.h"
+#include "mm_plugin.h"
+#include "range.h"
+#include "trace.h"
+#include "snapshot.h"
 #include "memlib.h"
 #include "fsecs.h"
+#include "ftimer.h"
+#include "perfctr.h"
 #include "config.h"
 
 /**********************
@@ -30,38 +41,20 @@
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
 
-/* Returns true if p is ALIGNMENT-byte aligned */
-#define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
+/* Repeated timing samples per trace (-n) */
+#define MAXSAMPLES  1000 /* max number of samples per trace */
+
+/* Allocators evaluated in one run: the built-in mm and -L plugins */
+#define MAXALLOCS     16
+
+/* Multithreaded replay */
+#define MAXTHREADS    64 /* max number of replay threads (-T) */
+#define MT_RUNS        5 /* report the best of MT_RUNS timed replays */
 
 /****************************** 
  * The key compound data types 
  *****************************/
 
-/* Records the extent of each block's payload */
-typedef struct range_t {
-    char *lo;              /* low payload address */
-    char *hi;              /* high payload address */
-    struct range_t *next;  /* next list element */
-} range_t;
-
-/* Characterizes a single trace operation (allocator request) */
-typedef struct {
-    enum {ALLOC, FREE, REALLOC} type; /* type of request */
-    int index;                        /* index for free() to use later */
-    int size;                         /* byte size of alloc/realloc request */
-} traceop_t;
-
-/* Holds the information for one trace file*/
-typedef struct {
-    int sugg_heapsize;   /* suggested heap size (unused) */
-    int num_ids;         /* number of alloc/realloc ids */
-    int num_ops;         /* number of distinct requests */
-    int weight;          /* weight for this trace (unused) */
-    traceop_t *ops;      /* array of requests */
-    char **blocks;       /* array of ptrs returned by malloc/realloc... */
-    size_t *block_sizes; /* ... and a corresponding array of payload sizes */
-} trace_t;
-
 /* 
  * Holds the params to the xxx_speed functions, which are timed by fcyc. 
  * This struct is necessary because fcyc accepts only a pointer array
@@ -70,8 +63,22 @@ typedef struct {
 typedef struct {
     trace_t *trace;  
     range_t *ranges;
+    int runs;        /* number of times the trace was replayed */
+    int touch;       /* touch every touch'th payload byte, 0 = never (-w) */
 } speed_t;
 
+/* Where the heap bytes go at the peak of a trace (-b) */
+enum {
+    W_LIVE,   /* requested payload bytes */
+    W_TAGS,   /* allocator overhead of allocated blocks (headers, footers) */
+    W_ALIGN,  /* rounding the request up to ALIGNMENT, memalign leads */
+    W_SLACK,  /* further unused payload: unsplit remainders and the like */
+    W_FREE,   /* free blocks */
+    W_META,   /* heap bytes outside any block (prologs, epilogs, ...) */
+    W_GROWTH, /* heap growth after the peak (the brk never shrinks) */
+    NWASTE
+};
+
 /* Summarizes the important stats for some malloc function on some trace */
 typedef struct {
     /* defined for both libc malloc and student malloc package (mm.c) */
@@ -81,6 +88,29 @@ typedef struct {
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    double avg_util; /* mean of live bytes / heap size over all ops */
+    double int_util; /* sum of live bytes / sum of heap size over all ops */
+
+    /* defined only if valid; secs is the median of the samples */
+    int nsamples;    /* number of timing samples (-n) */
+    double *samples; /* secs of each sample */
+    double secs_lo;  /* 95% confidence interval of secs... */
+    double secs_hi;  /* ...from the timer, or from the samples with -n */
+
+    /* defined only with -p */
+    perfctr_t perf;  /* hardware counters for one replay of the trace */
+
+    /* defined only with -w: the same replay, touching the payloads */
+    double touch_secs;  /* median secs of the touching replay */
+    perfctr_t touch_perf; /* hardware counters of one touching replay (-p) */
+
+    /* defined only with -T */
+    double mt_secs[MAXTHREADS+1]; /* replay time with 1..MAXTHREADS threads */
+
+    /* defined only with -b */
+    int peak_op;           /* first op at which the live bytes peak */
+    double heapsize;       /* final heap size */
+    double waste[NWASTE];  /* bytes of the final heap by category */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
@@ -90,6 +120,28 @@ typedef struct {
  *******************/
 int verbose = 0;        /* global flag for verbose output */
 static int errors = 0;  /* number of errs found when running student malloc */
+static int perf_counters = 0; /* collect hardware counters (set by -p) */
+static int max_threads = 0;   /* thread count limit for scaling runs (-T) */
+static int num_samples = 1;   /* timing samples per trace (-n) */
+static FILE *timeline_fp = NULL; /* utilization timeline output (-u) */
+static int touch_stride = 0;  /* payload touch density for replays (-w) */
+static volatile int touch_sink; /* keeps payload reads from being elided */
+static int waste_breakdown = 0; /* break down the waste at the peak (-b) */
+static FILE *snap_fp = NULL;  /* heap snapshot output (-D) */
+static int *snap_ops = NULL;  /* ops to take snapshots after (-d)... */
+static int num_snap_ops = 0;  /* ...their number... */
+static int snap_every = 0;    /* ...and/or every this many ops */
+
+/* The allocator being evaluated: the mm package linked into the driver,
+   or a plugin loaded with -L */
+static mm_plugin_t mm_builtin = {
+    MM_PLUGIN_VERSION, "mm", NULL, mm_malloc, mm_free, mm_realloc, 
+    mm_init, mm_print_stats, mm_walk, mm_list_count, mm_malloc_hint,
+    mm_memalign, mm_free_sized, mm_usable_size
+};
+static mm_plugin_t *allocator = &mm_builtin;
+static char *allocator_name = "mm";
+static int timeline_interval = 100; /* ops between timeline samples (-i) */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
 /* Directory where default tracefiles are found */
@@ -105,16 +157,6 @@ static char *default_tracefiles[] = {
  * Function prototypes 
  *********************/
 
-/* these functions manipulate range lists */
-static int add_range(range_t **ranges, char *lo, int size, 
-		     int tracenum, int opnum);
-static void remove_range(range_t **ranges, char *lo);
-static void clear_ranges(range_t **ranges);
-
-/* These functions read, allocate, and free storage for traces */
-static trace_t *read_trace(char *tracedir, char *filename);
-static void free_trace(trace_t *trace);
-
 /* Routines for evaluating the correctness and speed of libc malloc */
 static int eval_libc_valid(trace_t *trace, int tracenum);
 static void eval_libc_speed(void *ptr);
@@ -122,14 +164,49 @@ static void eval_libc_speed(void *ptr);
 /* Routines for evaluating correctnes, space utilization, and speed 
    of the student's malloc package in mm.c */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges,
+			   stats_t *stats);
+static void write_timeline(int tracenum, int opnum, int live);
+static void eval_mm_waste(trace_t *trace, stats_t *stats);
+static void parse_snap_ops(char *arg);
+static int snap_due(int opnum, int num_ops);
+static void write_snapshot(trace_t *trace, int tracenum, int opnum, int live);
 static void eval_mm_speed(void *ptr);
+static void *mm_alloc_op(traceop_t *op);
+static void *libc_alloc_op(traceop_t *op);
+static int mm_extent(char *p, int size, int tracenum, int opnum);
+
+/* Multithreaded replay of a trace with mm (use_mm) or libc malloc */
+static double eval_mt_speed(trace_t *trace, int nthreads, int use_mm);
+static void eval_mt_scaling(trace_t *trace, stats_t *stats, int use_mm);
+static int next_thread_count(int n);
+
+/* Write and read back the payloads during timed replays (-w) */
+static void touch_write(char *p, int size, int stride);
+static void touch_read(char *p, int size, int stride);
+
+/* Times one trace, collecting hardware counters if enabled */
+static double time_trace(fsecs_test_funct f, speed_t *speed, stats_t *stats);
+
+/* Loads an allocator plugin */
+static mm_plugin_t *load_plugin(char *path);
+static int mm_counters(void);
 
 /* Various helper routines */
+static double perf_index(int n, stats_t *stats, double *p1, double *p2);
 static void printresults(int n, stats_t *stats);
+static void printcompare(int n, char **tracefiles, int nalloc, char **names,
+			 stats_t **stats, int *errs);
+static void printcounters(int n, stats_t *stats);
+static void printscaling(int n, stats_t *stats);
+static void printutil(int n, stats_t *stats);
+static void printtouch(int n, stats_t *stats);
+static void printwaste(int n, stats_t *stats);
+static void writeresults(FILE *fp, int json, char *name, int n, 
+			 char **tracefiles, stats_t *stats);
+static double median(double *v, int n);
 static void usage(void);
 static void unix_error(char *msg);
-static void malloc_error(int tracenum, int opnum, char *msg);
 static void app_error(char *msg);
 
 /**************
@@ -145,19 +222,33 @@ int main(int argc, char **argv)
     range_t *ranges = NULL;    /* keeps track of block extents for one trace */
     stats_t *libc_stats = NULL;/* libc stats for each trace */
     stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
+    stats_t *stats;            /* stats of the allocator being evaluated */
+    mm_plugin_t *allocators[MAXALLOCS];  /* built-in mm, then -L plugins */
+    char *names[MAXALLOCS];              /* their names in the tables */
+    stats_t *alloc_stats[MAXALLOCS];     /* their stats for each trace */
+    int alloc_errors[MAXALLOCS];         /* their error counts */
+    int num_allocators = 1;
     speed_t speed_params;      /* input parameters to the xx_speed routines */ 
 
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    char *outfile = NULL;/* If set, write results to this file (-o) */
+    int json = 0;        /* If set, outfile is JSON rather than CSV */
+    FILE *outfp = NULL;
 
     /* temporaries used to compute the performance index */
-    double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
-    int numcorrect;
+    double p1, p2, perfindex;
+    int numcorrect, k;
+
+    allocators[0] = &mm_builtin;
+    names[0] = "mm";
+    if (!mm_counters())
+	mm_builtin.stats = NULL;
     
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:t:hvVgalbpT:n:o:u:i:L:w:c:D:d:")) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
@@ -180,6 +271,78 @@ int main(int argc, char **argv)
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'L': /* Load an allocator plugin */
+            if (num_allocators == MAXALLOCS) {
+                fprintf(stderr, "At most %d allocators\n", MAXALLOCS);
+                exit(1);
+            }
+            allocators[num_allocators] = load_plugin(optarg);
+            names[num_allocators] = (char *)allocators[num_allocators]->name;
+            for (k = 0; k < num_allocators; k++)
+                if (!strcmp(names[k], names[num_allocators]))
+                    names[num_allocators] = optarg; /* name taken, use path */
+            num_allocators++;
+            break;
+        case 'p': /* Collect hardware performance counters */
+            perf_counters = 1;
+            break;
+        case 'T': /* Measure scaling with up to this many replay threads */
+            max_threads = atoi(optarg);
+            if (max_threads < 1 || max_threads > MAXTHREADS) {
+                fprintf(stderr, "-T expects 1..%d threads\n", MAXTHREADS);
+                exit(1);
+            }
+            break;
+        case 'n': /* Number of timing samples per trace */
+            num_samples = atoi(optarg);
+            if (num_samples < 1 || num_samples > MAXSAMPLES) {
+                fprintf(stderr, "-n expects 1..%d samples\n", MAXSAMPLES);
+                exit(1);
+            }
+            break;
+        case 'o': /* Write machine-readable results (.json or .csv) */
+            outfile = optarg;
+            i = strlen(outfile);
+            json = i >= 5 && strcmp(outfile + i - 5, ".json") == 0;
+            break;
+        case 'u': /* Write a utilization timeline */
+            if ((timeline_fp = fopen(optarg, "w")) == NULL) {
+                sprintf(msg, "Could not open %s", optarg);
+                unix_error(msg);
+            }
+            break;
+        case 'i': /* Ops between two timeline samples */
+            timeline_interval = atoi(optarg);
+            if (timeline_interval < 1) {
+                fprintf(stderr, "-i expects a positive op count\n");
+                exit(1);
+            }
+            break;
+        case 'b': /* Break down the wasted bytes at the peak */
+            waste_breakdown = 1;
+            break;
+        case 'D': /* Write heap snapshots */
+            if ((snap_fp = fopen(optarg, "wb")) == NULL) {
+                sprintf(msg, "Could not open %s", optarg);
+                unix_error(msg);
+            }
+            break;
+        case 'd': /* Ops to take heap snapshots after */
+            parse_snap_ops(optarg);
+            break;
+        case 'c': /* Pin the timed replays to one CPU */
+            if (set_fsecs_cpu(atoi(optarg)) < 0) {
+                fprintf(stderr, "Cannot run on CPU %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'w': /* Touch the payloads during timed replays */
+            touch_stride = atoi(optarg);
+            if (touch_stride < 1) {
+                fprintf(stderr, "-w expects a positive number of bytes\n");
+                exit(1);
+            }
+            break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -208,6 +371,12 @@ int main(int argc, char **argv)
     /* Initialize the timing package */
     init_fsecs();
 
+    /* Open the hardware counters, or quietly go on without them */
+    if (perf_counters && perfctr_init() == 0) {
+	printf("Hardware performance counters unavailable, ignoring -p\n");
+	perf_counters = 0;
+    }
+
     /*
      * Optionally run and evaluate the libc malloc package 
      */
@@ -231,7 +400,10 @@ int main(int argc, char **argv)
 		speed_params.trace = trace;
 		if (verbose > 1)
 		    printf("and performance.\n");
-		libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
+		libc_stats[i].secs = time_trace(eval_libc_speed, &speed_params,
+						&libc_stats[i]);
+		if (max_threads)
+		    eval_mt_scaling(trace, &libc_stats[i], 0);
 	    }
 	    free_trace(trace);
 	}
@@ -241,81 +413,141 @@ int main(int argc, char **argv)
 	    printf("\nResults for libc malloc:\n");
 	    printresults(num_tracefiles, libc_stats);
 	}
+	if (perf_counters) {
+	    printf("\nHardware counters for libc malloc:\n");
+	    printcounters(num_tracefiles, libc_stats);
+	}
+	if (max_threads) {
+	    printf("\nThread scaling for libc malloc (Kops/sec):\n");
+	    printscaling(num_tracefiles, libc_stats);
+	}
+	if (touch_stride) {
+	    printf("\nPayload touch cost for libc malloc (stride %d):\n",
+		   touch_stride);
+	    printtouch(num_tracefiles, libc_stats);
+	}
     }
 
     /*
-     * Always run and evaluate the student's mm package
+     * Always run and evaluate the student's mm package, followed by
+     * the allocators loaded with -L
      */
-    if (verbose > 1)
-	printf("\nTesting mm malloc\n");
-
-    /* Allocate the mm stats array, with one stats_t struct per tracefile */
-    mm_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
-    if (mm_stats == NULL)
-	unix_error("mm_stats calloc in main failed");
     
     /* Initialize the simulated memory system in memlib.c */
     mem_init(); 
 
-    /* Evaluate student's mm malloc package using the K-best scheme */
-    for (i=0; i < num_tracefiles; i++) {
-	trace = read_trace(tracedir, tracefiles[i]);
-	mm_stats[i].ops = trace->num_ops;
+    if (timeline_fp)
+	fprintf(timeline_fp, 
+		"allocator,trace,op,live,heap,free,largest_free,free_lists\n");
+
+    for (k = 0; k < num_allocators; k++) {
+	allocator = allocators[k];
+	allocator_name = names[k];
 	if (verbose > 1)
-	    printf("Checking mm_malloc for correctness, ");
-	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
-	if (mm_stats[i].valid) {
-	    if (verbose > 1)
-		printf("efficiency, ");
-	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
-	    speed_params.trace = trace;
-	    speed_params.ranges = ranges;
+	    printf("\nTesting %s malloc\n", allocator_name);
+
+	/* Allocate the stats array, with one stats_t struct per tracefile */
+	alloc_stats[k] = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
+	if (alloc_stats[k] == NULL)
+	    unix_error("mm_stats calloc in main failed");
+	stats = alloc_stats[k];
+	errors = 0;
+
+	/* Evaluate the malloc package using the K-best scheme */
+	for (i=0; i < num_tracefiles; i++) {
+	    trace = read_trace(tracedir, tracefiles[i]);
+	    stats[i].ops = trace->num_ops;
 	    if (verbose > 1)
-		printf("and performance.\n");
-	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+		printf("Checking %s_malloc for correctness, ", allocator_name);
+	    stats[i].valid = eval_mm_valid(trace, i, &ranges);
+	    if (stats[i].valid) {
+		if (verbose > 1)
+		    printf("efficiency, ");
+		stats[i].util = eval_mm_util(trace, i, &ranges, &stats[i]);
+		if (verbose && allocator->stats) {
+		    /* statistics of a single replay, before the waste pass
+		       and the timing runs reset the allocator */
+		    printf("%s statistics after trace %d:\n", allocator_name, i);
+		    allocator->stats(stdout);
+		}
+		if (waste_breakdown)
+		    eval_mm_waste(trace, &stats[i]);
+		speed_params.trace = trace;
+		speed_params.ranges = ranges;
+		if (verbose > 1)
+		    printf("and performance.\n");
+		stats[i].secs = time_trace(eval_mm_speed, &speed_params,
+					   &stats[i]);
+		if (max_threads)
+		    eval_mt_scaling(trace, &stats[i], 1);
+	    }
+	    free_trace(trace);
 	}
-	free_trace(trace);
-    }
+	alloc_errors[k] = errors;
 
-    /* Display the mm results in a compact table */
-    if (verbose) {
-	printf("\nResults for mm malloc:\n");
-	printresults(num_tracefiles, mm_stats);
-	printf("\n");
+	/* Display the results in a compact table */
+	if (verbose) {
+	    printf("\nResults for %s malloc:\n", allocator_name);
+	    printresults(num_tracefiles, stats);
+	    printf("\n");
+	}
+	if (perf_counters) {
+	    printf("\nHardware counters for %s malloc:\n", allocator_name);
+	    printcounters(num_tracefiles, stats);
+	    printf("\n");
+	}
+	if (max_threads) {
+	    printf("\nThread scaling for %s malloc (Kops/sec):\n", 
+		   allocator_name);
+	    printscaling(num_tracefiles, stats);
+	    printf("\n");
+	}
+	if (touch_stride) {
+	    printf("\nPayload touch cost for %s malloc (stride %d):\n",
+		   allocator_name, touch_stride);
+	    printtouch(num_tracefiles, stats);
+	    printf("\n");
+	}
+	if (waste_breakdown) {
+	    printf("\nHeap at the peak for %s malloc (%% of the final heap):\n",
+		   allocator_name);
+	    printwaste(num_tracefiles, stats);
+	    printf("\n");
+	}
+	if (timeline_fp) {
+	    printf("\nUtilization over time for %s malloc:\n", allocator_name);
+	    printutil(num_tracefiles, stats);
+	    printf("\n");
+	}
     }
+    mm_stats = alloc_stats[0];
+    errors = alloc_errors[0];
+    if (perf_counters)
+	perfctr_deinit();
+    if (timeline_fp)
+	fclose(timeline_fp);
+    if (snap_fp)
+	fclose(snap_fp);
+
+    /* Compare all the allocators side by side */
+    if (num_allocators > 1)
+	printcompare(num_tracefiles, tracefiles, num_allocators, names, 
+		     alloc_stats, alloc_errors);
 
     /* 
      * Accumulate the aggregate statistics for the student's mm package 
      */
-    secs = 0;
-    ops = 0;
-    util = 0;
     numcorrect = 0;
     for (i=0; i < num_tracefiles; i++) {
-	secs += mm_stats[i].secs;
-	ops += mm_stats[i].ops;
-	util += mm_stats[i].util;
 	if (mm_stats[i].valid)
 	    numcorrect++;
     }
-    avg_mm_util = util/num_tracefiles;
 
     /* 
      * Compute and print the performance index 
      */
     if (errors == 0) {
-	avg_mm_throughput = ops/secs;
-
-	p1 = UTIL_WEIGHT * avg_mm_util;
-	if (avg_mm_throughput > AVG_LIBC_THRUPUT) {
-	    p2 = (double)(1.0 - UTIL_WEIGHT);
-	} 
-	else {
-	    p2 = ((double) (1.0 - UTIL_WEIGHT)) * 
-		(avg_mm_throughput/AVG_LIBC_THRUPUT);
-	}
-	
-	perfindex = (p1 + p2)*100.0;
+	perfindex = perf_index(num_tracefiles, mm_stats, &p1, &p2);
 	printf("Perf index = %.0f (util) + %.0f (thru) = %.0f/100\n",
 	       p1*100, 
 	       p2*100, 
@@ -332,225 +564,100 @@ int main(int argc, char **argv)
 	printf("perfidx:%.0f\n", perfindex);
     }
 
+    /* 
+     * Write the per-trace results and samples for later comparison 
+     */
+    if (outfile) {
+	if ((outfp = fopen(outfile, "w")) == NULL) {
+	    sprintf(msg, "Could not open %s", outfile);
+	    unix_error(msg);
+	}
+	if (json)
+	    fprintf(outfp, "{\n  \"perfindex\": %.2f,\n  \"results\": [\n", 
+		    perfindex);
+	else
+	    fprintf(outfp, "allocator,trace,file,valid,ops,util,sample,secs\n");
+	if (run_libc) {
+	    writeresults(outfp, json, "libc", num_tracefiles, tracefiles, 
+			 libc_stats);
+	    if (json)
+		fprintf(outfp, ",\n");
+	}
+	for (k = 0; k < num_allocators; k++) {
+	    writeresults(outfp, json, names[k], num_tracefiles, tracefiles, 
+			 alloc_stats[k]);
+	    if (json && k < num_allocators - 1)
+		fprintf(outfp, ",\n");
+	}
+	if (json)
+	    fprintf(outfp, "\n  ]\n}\n");
+	fclose(outfp);
+    }
+
     exit(0);
 }
 
 
-/*****************************************************************
- * The following routines manipulate the range list, which keeps 
- * track of the extent of every allocated block payload. We use the 
- * range list to detect any overlapping allocated blocks.
- ****************************************************************/
+/**********************************************************************
+ * The following functions evaluate the correctness, space utilization,
+ * and throughput of the libc and mm malloc packages.
+ **********************************************************************/
 
 /*
- * add_range - As directed by request opnum in trace tracenum,
- *     we've just called the student's mm_malloc to allocate a block of 
- *     size bytes at addr lo. After checking the block for correctness,
- *     we create a range struct for this block and add it to the range list. 
+ * mm_alloc_op - Call the allocator's malloc for an ALLOC request, its
+ *    memalign for an aligned one, with the request's lifetime hint if it
+ *    has one and the allocator takes hints
  */
-static int add_range(range_t **ranges, char *lo, int size, 
-		     int tracenum, int opnum)
+static void *mm_alloc_op(traceop_t *op)
 {
-    char *hi = lo + size - 1;
-    range_t *p;
-    char msg[MAXLINE];
-
-    assert(size > 0);
-
-    /* Payload addresses must be ALIGNMENT-byte aligned */
-    if (!IS_ALIGNED(lo)) {
-	sprintf(msg, "Payload address (%p) not aligned to %d bytes", 
-		lo, ALIGNMENT);
-        malloc_error(tracenum, opnum, msg);
-        return 0;
-    }
-
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
-	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
-		lo, hi, mem_heap_lo(), mem_heap_hi());
-	malloc_error(tracenum, opnum, msg);
-        return 0;
-    }
-
-    /* The payload must not overlap any other payloads */
-    for (p = *ranges;  p != NULL;  p = p->next) {
-        if ((lo >= p->lo && lo <= p-> hi) ||
-            (hi >= p->lo && hi <= p->hi)) {
-	    sprintf(msg, "Payload (%p:%p) overlaps another payload (%p:%p)\n",
-		    lo, hi, p->lo, p->hi);
-	    malloc_error(tracenum, opnum, msg);
-	    return 0;
-        }
-    }
-
-    /* 
-     * Everything looks OK, so remember the extent of this block 
-     * by creating a range struct and adding it the range list.
-     */
-    if ((p = (range_t *)malloc(sizeof(range_t))) == NULL)
-	unix_error("malloc error in add_range");
-    p->next = *ranges;
-    p->lo = lo;
-    p->hi = hi;
-    *ranges = p;
-    return 1;
-}
-
-/* 
- * remove_range - Free the range record of block whose payload starts at lo 
- */
-static void remove_range(range_t **ranges, char *lo)
-{
-    range_t *p;
-    range_t **prevpp = ranges;
-    // int size;
-
-    for (p = *ranges;  p != NULL; p = p->next) {
-        if (p->lo == lo) {
-	    *prevpp = p->next;
-            // size = p->hi - p->lo + 1;
-            free(p);
-            break;
-        }
-        prevpp = &(p->next);
-    }
+    if (op->align && allocator->memalign)
+	return allocator->memalign(op->align, op->size);
+    if (op->hint && allocator->malloc_hint)
+	return allocator->malloc_hint(op->size, op->hint);
+    return allocator->malloc(op->size);
 }
 
 /*
- * clear_ranges - free all of the range records for a trace 
+ * libc_alloc_op - The libc counterpart of mm_alloc_op
  */
-static void clear_ranges(range_t **ranges)
+static void *libc_alloc_op(traceop_t *op)
 {
-    range_t *p;
-    range_t *pnext;
+    void *p;
 
-    for (p = *ranges;  p != NULL;  p = pnext) {
-        pnext = p->next;
-        free(p);
+    if (op->align) {
+	if (posix_memalign(&p, op->align < sizeof(void *) ?
+			   sizeof(void *) : op->align, op->size) != 0)
+	    return NULL;
+	return p;
     }
-    *ranges = NULL;
+    return malloc(op->size);
 }
 
-
-/**********************************************
- * The following routines manipulate tracefiles
- *********************************************/
-
 /*
- * read_trace - read a trace file and store it in memory
+ * mm_extent - The bytes of the new block p that the range list covers:
+ *    the usable size, if the allocator reports one, so that its slack
+ *    must not overlap other blocks either; else the requested size.
+ *    -1 if the usable size is below the request
  */
-static trace_t *read_trace(char *tracedir, char *filename)
+static int mm_extent(char *p, int size, int tracenum, int opnum)
 {
-    FILE *tracefile;
-    trace_t *trace;
-    char type[MAXLINE];
-    char path[MAXLINE];
-    unsigned index, size;
-    unsigned max_index = 0;
-    unsigned op_index;
-
-    if (verbose > 1)
-	printf("Reading tracefile: %s\n", filename);
-
-    /* Allocate the trace record */
-    if ((trace = (trace_t *) malloc(sizeof(trace_t))) == NULL)
-	unix_error("malloc 1 failed in read_trance");
-	
-    /* Read the trace file header */
-    strcpy(path, tracedir);
-    strcat(path, filename);
-    if ((tracefile = fopen(path, "r")) == NULL) {
-	sprintf(msg, "Could not open %s in read_trace", path);
-	unix_error(msg);
-    }
-
-    int n_inputs;
-    n_inputs = fscanf(tracefile, "%d", &(trace->sugg_heapsize)); /* not used */
-    n_inputs = fscanf(tracefile, "%d", &(trace->num_ids));     
-    n_inputs = fscanf(tracefile, "%d", &(trace->num_ops));     
-    n_inputs = fscanf(tracefile, "%d", &(trace->weight));        /* not used */
-    // Ignore n_inputs
-    // if(n_inputs != 1)
-    //     exit(EXIT_FAILURE);
-
-    /* We'll store each request line in the trace in this array */
-    if ((trace->ops = 
-	 (traceop_t *)malloc(trace->num_ops * sizeof(traceop_t))) == NULL)
-	unix_error("malloc 2 failed in read_trace");
-
-    /* We'll keep an array of pointers to the allocated blocks here... */
-    if ((trace->blocks = 
-	 (char **)malloc(trace->num_ids * sizeof(char *))) == NULL)
-	unix_error("malloc 3 failed in read_trace");
-
-    /* ... along with the corresponding byte sizes of each block */
-    if ((trace->block_sizes = 
-	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
-	unix_error("malloc 4 failed in read_trace");
-    
-    /* read every request line in the trace file */
-    index = 0;
-    op_index = 0;
-    while (fscanf(tracefile, "%s", type) != EOF) {
-	switch(type[0]) {
-	case 'a':
-	    n_inputs = fscanf(tracefile, "%u %u", &index, &size);
-	    if(n_inputs != 2) fprintf(stderr, "option '%c' expect 2 more arguments", type[0]);
-	    trace->ops[op_index].type = ALLOC;
-	    trace->ops[op_index].index = index;
-	    trace->ops[op_index].size = size;
-	    max_index = (index > max_index) ? index : max_index;
-	    break;
-	case 'r':
-	    n_inputs = fscanf(tracefile, "%u %u", &index, &size);
-	    if(n_inputs != 2) fprintf(stderr, "option '%c' expect 2 more arguments", type[0]);
-	    trace->ops[op_index].type = REALLOC;
-	    trace->ops[op_index].index = index;
-	    trace->ops[op_index].size = size;
-	    max_index = (index > max_index) ? index : max_index;
-	    break;
-	case 'f':
-	    n_inputs = fscanf(tracefile, "%ud", &index);
-	    if(n_inputs != 1) fprintf(stderr, "option '%c' expect 1 more arguments", type[0]);
-	    trace->ops[op_index].type = FREE;
-	    trace->ops[op_index].index = index;
-	    break;
-	default:
-	    printf("Bogus type character (%c) in tracefile %s\n", 
-		   type[0], path);
-	    exit(1);
-	}
-	op_index++;
-	
+    size_t usable;
+
+    if (!allocator->usable_size)
+	return size;
+    usable = allocator->usable_size(p);
+    if (usable < (size_t)size) {
+	sprintf(msg, "mm_usable_size of a block (%p) is %lu, below its "
+		"%d bytes", p, (unsigned long)usable, size);
+	malloc_error(tracenum, opnum, msg);
+	return -1;
     }
-    fclose(tracefile);
-    assert(max_index == trace->num_ids - 1);
-    assert(trace->num_ops == op_index);
-    
-    return trace;
-}
-
-/*
- * free_trace - Free the trace record and the three arrays it points
- *              to, all of which were allocated in read_trace().
- */
-void free_trace(trace_t *trace)
-{
-    free(trace->ops);         /* free the three arrays... */
-    free(trace->blocks);      
-    free(trace->block_sizes);
-    free(trace);              /* and the trace record itself... */
+    return (int)usable;
 }
 
-/**********************************************************************
- * The following functions evaluate the correctness, space utilization,
- * and throughput of the libc and mm malloc packages.
- **********************************************************************/
-
 /*
- * eval_mm_valid - Check the mm malloc package for correctness
+ * eval_mm_valid - Check the mm malloc package for correctness. Blocks
+ *    are freed with the allocator's sized free, if it has one
  */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) 
 {
@@ -558,6 +665,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
     int index;
     int size;
     int oldsize;
+    int extent;
     char *newp;
     char *oldp;
     char *p;
@@ -567,7 +675,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
     clear_ranges(ranges);
 
     /* Call the mm package's init function */
-    if (mm_init() < 0) {
+    if (allocator->reset() < 0) {
 	malloc_error(tracenum, 0, "mm_init failed.");
 	return 0;
     }
@@ -582,7 +690,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
         case ALLOC: /* mm_malloc */
 
 	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+	    if ((p = mm_alloc_op(&trace->ops[i])) == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -592,8 +700,16 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     * to the range list if OK. The block must be  be aligned properly,
 	     * and must not overlap any currently allocated block. 
 	     */ 
-	    if (add_range(ranges, p, size, tracenum, i) == 0)
+	    if ((extent = mm_extent(p, size, tracenum, i)) < 0 ||
+		add_range(ranges, p, extent, tracenum, i) == 0)
+		return 0;
+	    if (trace->ops[i].align && allocator->memalign &&
+		(size_t)p % trace->ops[i].align != 0) {
+		sprintf(msg, "mm_memalign returned a block (%p) not aligned "
+			"to %d bytes", p, trace->ops[i].align);
+		malloc_error(tracenum, i, msg);
 		return 0;
+	    }
 	    
 	    /* ADDED: cgw
 	     * fill range with low byte of index.  This will be used later
@@ -611,7 +727,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    /* Call the student's realloc */
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp, size)) == NULL) {
+	    if ((newp = allocator->realloc(oldp, size)) == NULL) {
 		malloc_error(tracenum, i, "mm_realloc failed.");
 		return 0;
 	    }
@@ -620,7 +736,8 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    remove_range(ranges, oldp);
 	    
 	    /* Check new block for correctness and add it to range list */
-	    if (add_range(ranges, newp, size, tracenum, i) == 0)
+	    if ((extent = mm_extent(newp, size, tracenum, i)) < 0 ||
+		add_range(ranges, newp, extent, tracenum, i) == 0)
 		return 0;
 	    
 	    /* ADDED: cgw
@@ -649,7 +766,10 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remove region from list and call student's free function */
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
-	    mm_free(p);
+	    if (allocator->free_sized)
+		allocator->free_sized(p, trace->block_sizes[index]);
+	    else
+		allocator->free(p);
 	    break;
 
 	default:
@@ -672,20 +792,29 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
  *   doesn't allow the students to decrement the brk pointer, so brk
  *   is always the high water mark of the heap. 
  *   
+ *   Along the way we also record the utilization after every op, 
+ *   reduced to its mean (avg_util) and to the ratio of the areas under
+ *   the live bytes and heap size curves (int_util), and with -u we 
+ *   write a timeline sample every timeline_interval ops and with -D a
+ *   heap snapshot after the ops chosen with -d. For -b we remember the
+ *   op at which the live bytes peak and the final heap size.
  */
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges,
+			   stats_t *stats)
 {   
     int i;
     int index;
     int size, newsize, oldsize;
     int max_total_size = 0;
     int total_size = 0;
+    int peak_live = 0, peak_op = 0;
     char *p;
     char *newp, *oldp;
+    double heapsize, ratio_sum = 0, live_sum = 0, heap_sum = 0;
 
     /* initialize the heap and the mm malloc package */
     mem_reset_brk();
-    if (mm_init() < 0)
+    if (allocator->reset() < 0)
 	app_error("mm_init failed in eval_mm_util");
 
     for (i = 0;  i < trace->num_ops;  i++) {
@@ -695,7 +824,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if ((p = mm_alloc_op(&trace->ops[i])) == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
 	    
 	    /* Remember region and size */
@@ -717,7 +846,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp,newsize)) == NULL)
+	    if ((newp = allocator->realloc(oldp,newsize)) == NULL)
 		app_error("mm_realloc failed in eval_mm_util");
 
 	    /* Remember region and size */
@@ -738,7 +867,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    size = trace->block_sizes[index];
 	    p = trace->blocks[index];
 	    
-	    mm_free(p);
+	    allocator->free(p);
 	    
 	    /* Keep track of current total size
 	     * of all allocated blocks */
@@ -750,11 +879,333 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    app_error("Nonexistent request type in eval_mm_util");
 
         }
+
+	if (total_size > peak_live) {
+	    peak_live = total_size;
+	    peak_op = i;
+	}
+
+	/* Accumulate the utilization over time */
+	heapsize = (double)mem_heapsize();
+	if (heapsize > 0)
+	    ratio_sum += total_size / heapsize;
+	live_sum += total_size;
+	heap_sum += heapsize;
+
+	if (timeline_fp && ((i + 1) % timeline_interval == 0 || 
+			    i == trace->num_ops - 1))
+	    write_timeline(tracenum, i, total_size);
+	if (snap_fp && snap_due(i, trace->num_ops))
+	    write_snapshot(trace, tracenum, i, total_size);
     }
 
+    stats->avg_util = trace->num_ops ? ratio_sum / trace->num_ops : 0;
+    stats->int_util = heap_sum > 0 ? live_sum / heap_sum : 0;
+    stats->peak_op = peak_op;
+    stats->heapsize = mem_heapsize();
     return ((double)max_total_size / (double)mem_heapsize());
 }
 
+/* Free space summary collected by sum_free */
+typedef struct {
+    size_t free;         /* total bytes in free blocks */
+    size_t largest;      /* size of the largest free block */
+    size_t *list_free;   /* free bytes on each free list... */
+    int nlists;          /* ...and the number of lists */
+} freeinfo_t;
+
+/*
+ * sum_free - mm_walk callback that adds up the free blocks
+ */
+static void sum_free(mm_block_t *block, void *arg)
+{
+    freeinfo_t *info = (freeinfo_t *)arg;
+
+    if (!block->free)
+	return;
+    info->free += block->size;
+    if (block->size > info->largest)
+	info->largest = block->size;
+    if (block->list >= 0 && block->list < info->nlists)
+	info->list_free[block->list] += block->size;
+}
+
+/*
+ * write_timeline - Write one utilization timeline sample, taken after
+ *    op opnum of trace tracenum with live payload bytes allocated. The
+ *    free bytes of each free list go into one space separated field.
+ *    Allocators that cannot walk their heap get no timeline.
+ */
+static void write_timeline(int tracenum, int opnum, int live)
+{
+    freeinfo_t info;
+    int i;
+
+    if (!allocator->walk)
+	return;
+    info.free = info.largest = 0;
+    info.nlists = allocator->list_count ? allocator->list_count() : 0;
+    if ((info.list_free = (size_t *)calloc(info.nlists + 1, 
+					   sizeof(size_t))) == NULL)
+	unix_error("calloc failed in write_timeline");
+    allocator->walk(sum_free, &info);
+
+    fprintf(timeline_fp, "%s,%d,%d,%d,%lu,%lu,%lu,", allocator_name, 
+	    tracenum, opnum, live, (unsigned long)mem_heapsize(), 
+	    (unsigned long)info.free, (unsigned long)info.largest);
+    for (i = 0; i < info.nlists; i++)
+	fprintf(timeline_fp, "%s%lu", i ? " " : "", 
+		(unsigned long)info.list_free[i]);
+    fprintf(timeline_fp, "\n");
+    free(info.list_free);
+}
+
+/* A live block of the trace: its payload and requested size */
+typedef struct {
+    char *payload;
+    size_t size;
+} liveblock_t;
+
+/* Waste breakdown collected by add_waste */
+typedef struct {
+    liveblock_t *live;   /* live blocks sorted by payload address... */
+    int nlive;           /* ...and their number */
+    double *waste;       /* the categories of stats_t.waste */
+    double blocks;       /* bytes in blocks */
+} wasteinfo_t;
+
+/*
+ * cmp_payload - Order live blocks by payload address
+ */
+static int cmp_payload(const void *a, const void *b)
+{
+    const liveblock_t *x = a, *y = b;
+
+    return (x->payload > y->payload) - (x->payload < y->payload);
+}
+
+/*
+ * find_live - The live block with the lowest payload in [lo, hi), or NULL
+ */
+static liveblock_t *find_live(wasteinfo_t *info, char *lo, char *hi)
+{
+    int l = 0, h = info->nlive, m;
+
+    while (l < h) {
+	m = (l + h) / 2;
+	if (info->live[m].payload < lo)
+	    l = m + 1;
+	else
+	    h = m;
+    }
+    if (l == info->nlive || info->live[l].payload >= hi)
+	return NULL;
+    return &info->live[l];
+}
+
+/*
+ * add_waste - mm_walk callback that attributes the bytes of a block
+ */
+static void add_waste(mm_block_t *block, void *arg)
+{
+    wasteinfo_t *info = (wasteinfo_t *)arg;
+    liveblock_t *lb;
+    size_t usable, aligned, lead;
+
+    info->blocks += block->size;
+    if (block->free) {
+	info->waste[W_FREE] += block->size;
+	return;
+    }
+    info->waste[W_TAGS] += block->overhead;
+    usable = block->size - block->overhead;
+    /* mm_memalign may return a payload past the start of the block's */
+    lb = find_live(info, block->payload, (char *)block->payload + usable);
+    lead = lb ? lb->payload - (char *)block->payload : 0;
+    if (lb == NULL || lb->size > usable - lead) {
+	/* not a block of the trace: count it all as slack */
+	info->waste[W_SLACK] += usable;
+	return;
+    }
+    usable -= lead;
+    aligned = (lb->size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    if (aligned > usable)
+	aligned = usable;
+    info->waste[W_LIVE] += lb->size;
+    info->waste[W_ALIGN] += lead + aligned - lb->size;
+    info->waste[W_SLACK] += usable - aligned;
+}
+
+/*
+ * eval_mm_waste - Attribute the bytes of the final heap: replay the
+ *    trace up to its peak (stats->peak_op, found by eval_mm_util) and
+ *    walk the heap there. The live payload plus all the categories add 
+ *    up to the final heap size. Needs the walk hook; the allocator must
+ *    be deterministic, which eval_mm_valid does not check.
+ */
+static void eval_mm_waste(trace_t *trace, stats_t *stats)
+{
+    wasteinfo_t info;
+    char *live, *p;
+    int i, index;
+
+    memset(stats->waste, 0, sizeof(stats->waste));
+    if (!allocator->walk)
+	return;
+    if ((live = calloc(trace->num_ids, 1)) == NULL ||
+	(info.live = malloc(trace->num_ids * sizeof(liveblock_t))) == NULL)
+	unix_error("malloc failed in eval_mm_waste");
+
+    mem_reset_brk();
+    if (allocator->reset() < 0)
+	app_error("mm_init failed in eval_mm_waste");
+    for (i = 0; i <= stats->peak_op && i < trace->num_ops; i++) {
+	index = trace->ops[i].index;
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    if ((p = mm_alloc_op(&trace->ops[i])) == NULL)
+		app_error("mm_malloc failed in eval_mm_waste");
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = trace->ops[i].size;
+	    live[index] = 1;
+	    break;
+	case REALLOC:
+	    if ((p = allocator->realloc(trace->blocks[index], 
+					trace->ops[i].size)) == NULL)
+		app_error("mm_realloc failed in eval_mm_waste");
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = trace->ops[i].size;
+	    break;
+	case FREE:
+	    allocator->free(trace->blocks[index]);
+	    live[index] = 0;
+	    break;
+	}
+    }
+
+    info.nlive = 0;
+    for (index = 0; index < trace->num_ids; index++) {
+	if (!live[index])
+	    continue;
+	info.live[info.nlive].payload = trace->blocks[index];
+	info.live[info.nlive].size = trace->block_sizes[index];
+	info.nlive++;
+    }
+    qsort(info.live, info.nlive, sizeof(liveblock_t), cmp_payload);
+    info.waste = stats->waste;
+    info.blocks = 0;
+    allocator->walk(add_waste, &info);
+    stats->waste[W_META] = mem_heapsize() - info.blocks;
+    stats->waste[W_GROWTH] = stats->heapsize - mem_heapsize();
+
+    free(live);
+    free(info.live);
+}
+
+/*
+ * parse_snap_ops - Parse the -d argument: a comma separated list of op
+ *    numbers, where "%<n>" stands for every <n>th op
+ */
+static void parse_snap_ops(char *arg)
+{
+    char *tok, *end;
+    long n;
+
+    for (tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+	n = strtol(tok + (*tok == '%'), &end, 10);
+	if (*end || end == tok + (*tok == '%') || n < (*tok == '%')) {
+	    fprintf(stderr, "-d expects ops like 100,250 or %%50, not %s\n",
+		    tok);
+	    exit(1);
+	}
+	if (*tok == '%') {
+	    snap_every = n;
+	    continue;
+	}
+	if ((snap_ops = realloc(snap_ops, (num_snap_ops + 1) * 
+				sizeof(int))) == NULL)
+	    unix_error("realloc failed in parse_snap_ops");
+	snap_ops[num_snap_ops++] = n;
+    }
+}
+
+/*
+ * snap_due - Is a snapshot due after op opnum? Without -d there is one
+ *    after the last op.
+ */
+static int snap_due(int opnum, int num_ops)
+{
+    int i;
+
+    if (num_snap_ops == 0 && snap_every == 0)
+	return opnum == num_ops - 1;
+    if (snap_every && (opnum + 1) % snap_every == 0)
+	return 1;
+    for (i = 0; i < num_snap_ops; i++)
+	if (snap_ops[i] == opnum)
+	    return 1;
+    return 0;
+}
+
+/* Blocks of one snapshot, collected by add_snap_block */
+typedef struct {
+    snap_block_t *blocks;
+    int n, max;
+} snapbuf_t;
+
+/*
+ * add_snap_block - mm_walk callback that records a block for a snapshot
+ */
+static void add_snap_block(mm_block_t *block, void *arg)
+{
+    snapbuf_t *buf = (snapbuf_t *)arg;
+    snap_block_t *b;
+
+    if (buf->n == buf->max) {
+	buf->max = buf->max ? 2 * buf->max : 1024;
+	if ((buf->blocks = realloc(buf->blocks, 
+				   buf->max * sizeof(snap_block_t))) == NULL)
+	    unix_error("realloc failed in add_snap_block");
+    }
+    b = &buf->blocks[buf->n++];
+    b->offset = (char *)block->payload - (char *)mem_heap_lo();
+    b->size = block->size;
+    b->overhead = block->overhead;
+    b->free = block->free != 0;
+    b->list = block->list;
+}
+
+/*
+ * write_snapshot - Write the block layout of the heap after op opnum of
+ *    trace tracenum, with live payload bytes allocated, to the -D file
+ *    (see snapshot.h). Allocators that cannot walk their heap get none.
+ */
+static void write_snapshot(trace_t *trace, int tracenum, int opnum, int live)
+{
+    static snapbuf_t buf;
+    snap_header_t hdr;
+
+    if (!allocator->walk)
+	return;
+    buf.n = 0;
+    allocator->walk(add_snap_block, &buf);
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SNAP_MAGIC;
+    hdr.version = SNAP_VERSION;
+    strncpy(hdr.allocator, allocator_name, SNAP_NAMELEN - 1);
+    hdr.trace = tracenum;
+    hdr.op = opnum;
+    hdr.type = "afr"[trace->ops[opnum].type];
+    hdr.id = trace->ops[opnum].index;
+    hdr.live = live;
+    hdr.heapsize = mem_heapsize();
+    hdr.nlists = allocator->list_count ? allocator->list_count() : 0;
+    hdr.nblocks = buf.n;
+    if (fwrite(&hdr, sizeof(hdr), 1, snap_fp) != 1 ||
+	fwrite(buf.blocks, sizeof(snap_block_t), buf.n, snap_fp) != buf.n)
+	unix_error("fwrite failed in write_snapshot");
+}
 
 /*
  * eval_mm_speed - This is the function that is used by fcyc()
@@ -765,10 +1216,13 @@ static void eval_mm_speed(void *ptr)
     int i, index, size, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
+    int touch = ((speed_t *)ptr)->touch;
+
+    ((speed_t *)ptr)->runs++;
 
     /* Reset the heap and initialize the mm package */
     mem_reset_brk();
-    if (mm_init() < 0) 
+    if (allocator->reset() < 0) 
 	app_error("mm_init failed in eval_mm_speed");
 
     /* Interpret each trace request */
@@ -778,24 +1232,36 @@ static void eval_mm_speed(void *ptr)
         case ALLOC: /* mm_malloc */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
+            if ((p = mm_alloc_op(&trace->ops[i])) == NULL)
 		app_error("mm_malloc error in eval_mm_speed");
             trace->blocks[index] = p;
+	    if (touch) {
+		touch_write(p, size, touch);
+		trace->block_sizes[index] = size;
+	    }
             break;
 
 	case REALLOC: /* mm_realloc */
 	    index = trace->ops[i].index;
             newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL)
+	    if (touch)
+		touch_read(oldp, trace->block_sizes[index], touch);
+            if ((newp = allocator->realloc(oldp,newsize)) == NULL)
 		app_error("mm_realloc error in eval_mm_speed");
             trace->blocks[index] = newp;
+	    if (touch) {
+		touch_write(newp, newsize, touch);
+		trace->block_sizes[index] = newsize;
+	    }
             break;
 
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+	    if (touch)
+		touch_read(block, trace->block_sizes[index], touch);
+            allocator->free(block);
             break;
 
 	default:
@@ -818,7 +1284,7 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
         switch (trace->ops[i].type) {
 
         case ALLOC: /* malloc */
-	    if ((p = malloc(trace->ops[i].size)) == NULL) {
+	    if ((p = libc_alloc_op(&trace->ops[i])) == NULL) {
 		malloc_error(tracenum, i, "libc malloc failed");
 		unix_error("System message");
 	    }
@@ -858,41 +1324,446 @@ static void eval_libc_speed(void *ptr)
     int index, size, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
+    int touch = ((speed_t *)ptr)->touch;
+
+    ((speed_t *)ptr)->runs++;
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
         case ALLOC: /* malloc */
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
-	    if ((p = malloc(size)) == NULL)
+	    if ((p = libc_alloc_op(&trace->ops[i])) == NULL)
 		unix_error("malloc failed in eval_libc_speed");
 	    trace->blocks[index] = p;
+	    if (touch) {
+		touch_write(p, size, touch);
+		trace->block_sizes[index] = size;
+	    }
 	    break;
 
 	case REALLOC: /* realloc */
 	    index = trace->ops[i].index;
 	    newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
+	    if (touch)
+		touch_read(oldp, trace->block_sizes[index], touch);
 	    if ((newp = realloc(oldp, newsize)) == NULL)
 		unix_error("realloc failed in eval_libc_speed\n");
 	    
 	    trace->blocks[index] = newp;
+	    if (touch) {
+		touch_write(newp, newsize, touch);
+		trace->block_sizes[index] = newsize;
+	    }
 	    break;
 	    
         case FREE: /* free */
 	    index = trace->ops[i].index;
 	    block = trace->blocks[index];
+	    if (touch)
+		touch_read(block, trace->block_sizes[index], touch);
 	    free(block);
 	    break;
 	}
     }
 }
 
+/*********************************************************************
+ * The following routines replay a trace on several threads. Each op
+ * runs on thread (tid % nthreads), where tid is the thread column of
+ * the trace, or the request id if the trace has no thread column.
+ * Ops on the same id are executed in trace order, even if they run on
+ * different threads, so cross-thread frees and reallocs are preserved.
+ * mm.c is not thread-safe, so mm calls are serialized by a single lock.
+ *********************************************************************/
+
+/* Shared state of one multithreaded replay */
+typedef struct {
+    trace_t *trace;
+    int use_mm;          /* replay with mm (locked) instead of libc */
+    int nthreads;        /* number of replay threads */
+    int **ops;           /* ops[t]: op numbers replayed by thread t... */
+    int *nops;           /* ...and how many of them there are */
+    int *seq;            /* seq[i]: number of earlier ops on the same id */
+    int *done;           /* done[id]: number of ops on id completed so far */
+    pthread_barrier_t start; /* releases all threads at once */
+} mtreplay_t;
+
+/* Argument and timing of each replay thread */
+typedef struct {
+    mtreplay_t *mt;
+    int tid;
+    double start;        /* time the thread left the start barrier */
+    double end;          /* time the thread finished its last op */
+} mtthread_t;
+
+static pthread_mutex_t mm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * mt_now - monotonic wall clock time in seconds
+ */
+static double mt_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1E-9*ts.tv_nsec;
+}
+
+/*
+ * mt_thread - replay the ops of one thread, waiting for the previous op 
+ *     on the same id whenever it belongs to another thread
+ */
+static void *mt_thread(void *arg)
+{
+    mtthread_t *self = (mtthread_t *)arg;
+    mtreplay_t *mt = self->mt;
+    int tid = self->tid;
+    trace_t *trace = mt->trace;
+    int i, j, index, size;
+    char *p;
+
+    pthread_barrier_wait(&mt->start);
+    self->start = mt_now();
+
+    for (j = 0; j < mt->nops[tid]; j++) {
+	i = mt->ops[tid][j];
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
+
+	/* wait for the ops on this id that precede us in the trace */
+	while (__atomic_load_n(&mt->done[index], __ATOMIC_ACQUIRE) != mt->seq[i])
+	    sched_yield();
+
+	if (mt->use_mm)
+	    pthread_mutex_lock(&mm_lock);
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    p = mt->use_mm ? mm_alloc_op(&trace->ops[i]) :
+		libc_alloc_op(&trace->ops[i]);
+	    if (p == NULL)
+		app_error("malloc failed in eval_mt_speed");
+	    trace->blocks[index] = p;
+	    break;
+	case REALLOC:
+	    p = trace->blocks[index];
+	    p = mt->use_mm ? allocator->realloc(p, size) : realloc(p, size);
+	    if (p == NULL)
+		app_error("realloc failed in eval_mt_speed");
+	    trace->blocks[index] = p;
+	    break;
+	case FREE:
+	    if (mt->use_mm)
+		allocator->free(trace->blocks[index]);
+	    else
+		free(trace->blocks[index]);
+	    break;
+	}
+	if (mt->use_mm)
+	    pthread_mutex_unlock(&mm_lock);
+
+	__atomic_store_n(&mt->done[index], mt->seq[i] + 1, __ATOMIC_RELEASE);
+    }
+    self->end = mt_now();
+    return NULL;
+}
+
+/*
+ * eval_mt_speed - Replay the trace on nthreads threads and return the
+ *     best wall clock time of MT_RUNS replays. Thread startup is not
+ *     timed: a replay runs from the first thread leaving the start 
+ *     barrier to the last thread finishing.
+ */
+static double eval_mt_speed(trace_t *trace, int nthreads, int use_mm)
+{
+    mtreplay_t mt;
+    mtthread_t args[MAXTHREADS];
+    pthread_t threads[MAXTHREADS];
+    double start, end, best = DBL_MAX;
+    int *next, i, t, run;
+
+    mt.trace = trace;
+    mt.use_mm = use_mm;
+    mt.nthreads = nthreads;
+    mt.ops = (int **)malloc(nthreads * sizeof(int *));
+    mt.nops = (int *)calloc(nthreads, sizeof(int));
+    mt.seq = (int *)malloc(trace->num_ops * sizeof(int));
+    mt.done = (int *)malloc(trace->num_ids * sizeof(int));
+    next = (int *)calloc(trace->num_ids, sizeof(int));
+    if (!mt.ops || !mt.nops || !mt.seq || !mt.done || !next)
+	unix_error("malloc failed in eval_mt_speed");
+
+    /* Assign each op to a thread, and number the ops on each id */
+    for (i = 0; i < trace->num_ops; i++) {
+	t = trace->num_threads > 1 ? trace->ops[i].tid : trace->ops[i].index;
+	mt.nops[t % nthreads]++;
+	mt.seq[i] = next[trace->ops[i].index]++;
+    }
+    for (t = 0; t < nthreads; t++) {
+	if ((mt.ops[t] = (int *)malloc((mt.nops[t] + 1) * sizeof(int))) == NULL)
+	    unix_error("malloc failed in eval_mt_speed");
+	mt.nops[t] = 0;
+    }
+    for (i = 0; i < trace->num_ops; i++) {
+	t = trace->num_threads > 1 ? trace->ops[i].tid : trace->ops[i].index;
+	t %= nthreads;
+	mt.ops[t][mt.nops[t]++] = i;
+    }
+
+    for (run = 0; run < MT_RUNS; run++) {
+	if (use_mm) {
+	    mem_reset_brk();
+	    if (allocator->reset() < 0)
+		app_error("mm_init failed in eval_mt_speed");
+	}
+	memset(mt.done, 0, trace->num_ids * sizeof(int));
+	pthread_barrier_init(&mt.start, NULL, nthreads + 1);
+
+	for (t = 0; t < nthreads; t++) {
+	    args[t].mt = &mt;
+	    args[t].tid = t;
+	    if (pthread_create(&threads[t], NULL, mt_thread, &args[t]) != 0)
+		unix_error("pthread_create failed in eval_mt_speed");
+	}
+	pthread_barrier_wait(&mt.start);
+	for (t = 0; t < nthreads; t++)
+	    pthread_join(threads[t], NULL);
+	pthread_barrier_destroy(&mt.start);
+
+	start = args[0].start;
+	end = args[0].end;
+	for (t = 1; t < nthreads; t++) {
+	    start = args[t].start < start ? args[t].start : start;
+	    end = args[t].end > end ? args[t].end : end;
+	}
+	if (end - start < best)
+	    best = end - start;
+    }
+
+    for (t = 0; t < nthreads; t++)
+	free(mt.ops[t]);
+    free(mt.ops);
+    free(mt.nops);
+    free(mt.seq);
+    free(mt.done);
+    free(next);
+    return best;
+}
+
+/*
+ * eval_mt_scaling - Replay the trace with 1, 2, 4, ... up to max_threads
+ *     threads and record the times in stats->mt_secs
+ */
+static void eval_mt_scaling(trace_t *trace, stats_t *stats, int use_mm)
+{
+    int n;
+
+    for (n = 1; n <= max_threads; n = next_thread_count(n))
+	stats->mt_secs[n] = eval_mt_speed(trace, n, use_mm);
+}
+
+/*
+ * next_thread_count - step through the thread counts of a scaling run:
+ *     1, 2, 4, ... and finally max_threads itself
+ */
+static int next_thread_count(int n)
+{
+    if (n < max_threads && n * 2 > max_threads)
+	return max_threads;
+    return n * 2;
+}
+
+/*
+ * mm_counters - Does the built-in mm package keep event counters
+ *    (mm.c built with -DMM_STATS)? 
+ */
+static int mm_counters(void)
+{
+    return mm_stats(NULL) == 0;
+}
+
+/*
+ * load_plugin - Load an allocator plugin (see mm_plugin.h) from the 
+ *    shared object at path and initialize it
+ */
+static mm_plugin_t *load_plugin(char *path)
+{
+    void *handle;
+    mm_plugin_t *p, *q;
+
+    if ((handle = dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL) {
+	printf("Could not load %s: %s\n", path, dlerror());
+	exit(1);
+    }
+    if ((p = (mm_plugin_t *)dlsym(handle, MM_PLUGIN_SYMBOL)) == NULL) {
+	printf("%s does not export %s\n", path, MM_PLUGIN_SYMBOL);
+	exit(1);
+    }
+    if (p->version < 1 || p->version > MM_PLUGIN_VERSION) {
+	printf("%s has plugin version %d, expected 1 to %d\n", path,
+	       p->version, MM_PLUGIN_VERSION);
+	exit(1);
+    }
+    if (p->version < MM_PLUGIN_VERSION) {
+	/* copy the fields an older plugin has; the newer ones stay NULL */
+	if ((q = calloc(1, sizeof(mm_plugin_t))) == NULL)
+	    unix_error("calloc failed in load_plugin");
+	memcpy(q, p, p->version < 2 ? offsetof(mm_plugin_t, malloc_hint) :
+	       p->version < 3 ? offsetof(mm_plugin_t, memalign) :
+	       offsetof(mm_plugin_t, free_sized));
+	p = q;
+    }
+    if (!p->name || !p->malloc || !p->free || !p->realloc || !p->reset) {
+	printf("%s lacks a required plugin function\n", path);
+	exit(1);
+    }
+    if (p->init && p->init() < 0) {
+	printf("%s: plugin init failed\n", path);
+	exit(1);
+    }
+    return p;
+}
+
+/*
+ * touch_write - Write one byte in every stride bytes of a payload, as
+ *    a program initializing its new block would
+ */
+static void touch_write(char *p, int size, int stride)
+{
+    int j;
+
+    for (j = 0; j < size; j += stride)
+	p[j] = (char)j;
+}
+
+/*
+ * touch_read - Read back the bytes written by touch_write before the
+ *    payload is freed or reallocated
+ */
+static void touch_read(char *p, int size, int stride)
+{
+    int j, sum = 0;
+
+    for (j = 0; j < size; j += stride)
+	sum += p[j];
+    touch_sink += sum;
+}
+
+/*
+ * time_touch - Time the replay function f again with payload touching
+ *    on, the same way as time_trace, and store the median in 
+ *    stats->touch_secs. The difference to the plain replay is the cost
+ *    of using the blocks where the allocator placed them.
+ */
+static void time_touch(fsecs_test_funct f, speed_t *speed, stats_t *stats)
+{
+    double *samples;
+    int i, k;
+
+    if ((samples = (double *)malloc(num_samples * sizeof(double))) == NULL)
+	unix_error("malloc failed in time_touch");
+
+    speed->touch = touch_stride;
+    for (k = 0; k < num_samples; k++) {
+	speed->runs = 0;
+	if (perf_counters)
+	    perfctr_start();
+	samples[k] = fsecs(f, speed);
+	if (!perf_counters)
+	    continue;
+	perfctr_stop(&stats->touch_perf);
+	for (i = 0; i < PC_NEVENTS; i++)
+	    if (speed->runs > 0)
+		stats->touch_perf.count[i] /= speed->runs;
+    }
+    speed->touch = 0;
+    stats->touch_secs = median(samples, num_samples);
+    free(samples);
+}
+
+/*
+ * time_trace - Time the replay function f on one trace with fsecs,
+ *    num_samples times, and return the median sample. With -p, the 
+ *    hardware counters run around all of the timed replays of a sample
+ *    and are then reduced to the counts for a single replay. With -w,
+ *    the touching replay is timed as well. The 95% confidence interval
+ *    of the result goes to stats->secs_lo/hi.
+ */
+static double time_trace(fsecs_test_funct f, speed_t *speed, stats_t *stats)
+{
+    double *sorted, secs;
+    int i, k;
+
+    speed->touch = 0;
+    stats->nsamples = num_samples;
+    if ((stats->samples = (double *)malloc(num_samples * sizeof(double))) == NULL)
+	unix_error("malloc failed in time_trace");
+
+    for (k = 0; k < num_samples; k++) {
+	speed->runs = 0;
+	if (!perf_counters) {
+	    stats->samples[k] = fsecs(f, speed);
+	    continue;
+	}
+	perfctr_start();
+	stats->samples[k] = fsecs(f, speed);
+	perfctr_stop(&stats->perf);
+	for (i = 0; i < PC_NEVENTS; i++)
+	    if (speed->runs > 0)
+		stats->perf.count[i] /= speed->runs;
+    }
+    if (touch_stride)
+	time_touch(f, speed, stats);
+
+    /* with one sample, the timer knows the spread of the replays */
+    if (num_samples == 1) {
+	fsecs_ci(&stats->secs_lo, &stats->secs_hi);
+	return stats->samples[0];
+    }
+    if ((sorted = (double *)malloc(num_samples * sizeof(double))) == NULL)
+	unix_error("malloc failed in time_trace");
+    memcpy(sorted, stats->samples, num_samples * sizeof(double));
+    secs = ftimer_median_ci(sorted, num_samples, &stats->secs_lo, 
+			    &stats->secs_hi);
+    free(sorted);
+    return secs;
+}
+
 /*************************************
  * Some miscellaneous helper routines
  ************************************/
 
 
+/*
+ * perf_index - computes the performance index of a malloc package from
+ *    its per-trace stats, along with its util (p1) and throughput (p2) 
+ *    parts
+ */
+static double perf_index(int n, stats_t *stats, double *p1, double *p2)
+{
+    double secs = 0, ops = 0, util = 0, avg_util, avg_throughput;
+    int i;
+
+    for (i=0; i < n; i++) {
+	secs += stats[i].secs;
+	ops += stats[i].ops;
+	util += stats[i].util;
+    }
+    avg_util = util/n;
+    avg_throughput = ops/secs;
+
+    *p1 = UTIL_WEIGHT * avg_util;
+    if (avg_throughput > AVG_LIBC_THRUPUT) {
+	*p2 = (double)(1.0 - UTIL_WEIGHT);
+    } 
+    else {
+	*p2 = ((double) (1.0 - UTIL_WEIGHT)) * 
+	    (avg_throughput/AVG_LIBC_THRUPUT);
+    }
+    return (*p1 + *p2)*100.0;
+}
+
 /*
  * printresults - prints a performance summary for some malloc package
  */
@@ -904,17 +1775,20 @@ static void printresults(int n, stats_t *stats)
     double util = 0;
 
     /* Print the individual results for each trace */
-    printf("%5s%7s %5s%8s%10s%6s\n", 
-	   "trace", " valid", "util", "ops", "secs", "Kops");
+    printf("%5s%7s %5s%8s%10s%6s%8s\n", 
+	   "trace", " valid", "util", "ops", "secs", "Kops", "ci95");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f%6s%.1f%%\n", 
 		   i,
 		   "yes",
 		   stats[i].util*100.0,
 		   stats[i].ops,
 		   stats[i].secs,
-		   (stats[i].ops/1e3)/stats[i].secs);
+		   (stats[i].ops/1e3)/stats[i].secs,
+		   "+-",
+		   stats[i].secs > 0 ? 50.0 * (stats[i].secs_hi - 
+			stats[i].secs_lo) / stats[i].secs : 0.0);
 	    secs += stats[i].secs;
 	    ops += stats[i].ops;
 	    util += stats[i].util;
@@ -931,7 +1805,9 @@ static void printresults(int n, stats_t *stats)
     }
 
     /* Print the aggregate results for the set of traces */
-    if (errors == 0) {
+    for (i=0; i < n && stats[i].valid; i++)
+	;
+    if (i == n) {
 	printf("%12s%5.0f%%%8.0f%10.6f%6.0f\n", 
 	       "Total       ",
 	       (util/n)*100.0,
@@ -950,6 +1826,253 @@ static void printresults(int n, stats_t *stats)
 
 }
 
+/*
+ * printcompare - prints the util and throughput of several malloc 
+ *    packages on each trace side by side, and their performance indices
+ */
+static void printcompare(int n, char **tracefiles, int nalloc, char **names,
+			 stats_t **stats, int *errs)
+{
+    double p1, p2;
+    int i, k;
+
+    printf("\nSide by side results (util / Kops):\n");
+    printf("%-20s", "trace");
+    for (k = 0; k < nalloc; k++)
+	printf(" %15.15s", names[k]);
+    printf("\n");
+
+    for (i = 0; i < n; i++) {
+	printf("%-20.20s", tracefiles[i]);
+	for (k = 0; k < nalloc; k++) {
+	    if (stats[k][i].valid)
+		printf(" %6.0f%% %7.0f", stats[k][i].util*100.0,
+		       (stats[k][i].ops/1e3)/stats[k][i].secs);
+	    else
+		printf(" %15s", "invalid");
+	}
+	printf("\n");
+    }
+
+    printf("%-20s", "perf index");
+    for (k = 0; k < nalloc; k++) {
+	if (errs[k] == 0)
+	    printf(" %15.0f", perf_index(n, stats[k], &p1, &p2));
+	else
+	    printf(" %15s", "-");
+    }
+    printf("\n\n");
+}
+
+/*
+ * printcounters - prints the hardware counters of each trace, both for
+ *    a whole replay of the trace and per operation
+ */
+static void printcounters(int n, stats_t *stats)
+{
+    int i, j;
+
+    printf("%5s%8s", "trace", "ops");
+    for (j = 0; j < PC_NEVENTS; j++)
+	printf("%12s", perfctr_name(j));
+    printf("%6s\n", "IPC");
+
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%11s\n", i, "-");
+	    continue;
+	}
+
+	/* counts for one replay of the trace */
+	printf("%2d%11.0f", i, stats[i].ops);
+	for (j = 0; j < PC_NEVENTS; j++) {
+	    if (stats[i].perf.valid[j])
+		printf("%12.0f", stats[i].perf.count[j]);
+	    else
+		printf("%12s", "-");
+	}
+	if (stats[i].perf.valid[PC_CYCLES] && stats[i].perf.valid[PC_INSTRS] &&
+	    stats[i].perf.count[PC_CYCLES] > 0)
+	    printf("%6.2f", stats[i].perf.count[PC_INSTRS] / 
+		   stats[i].perf.count[PC_CYCLES]);
+	printf("\n");
+
+	/* the same counts per operation */
+	printf("%13s", "per op");
+	for (j = 0; j < PC_NEVENTS; j++) {
+	    if (stats[i].perf.valid[j])
+		printf("%12.2f", stats[i].perf.count[j] / stats[i].ops);
+	    else
+		printf("%12s", "-");
+	}
+	printf("\n");
+    }
+}
+
+/*
+ * printscaling - prints the throughput of each trace versus the number
+ *    of replay threads
+ */
+static void printscaling(int n, stats_t *stats)
+{
+    int i, t;
+
+    printf("%5s", "trace");
+    for (t = 1; t <= max_threads; t = next_thread_count(t))
+	printf("%8s%-2d", "T=", t);
+    printf("\n");
+
+    for (i = 0; i < n; i++) {
+	printf("%2d   ", i);
+	for (t = 1; t <= max_threads; t = next_thread_count(t)) {
+	    if (stats[i].valid && stats[i].mt_secs[t] > 0)
+		printf("%10.0f", (stats[i].ops/1e3) / stats[i].mt_secs[t]);
+	    else
+		printf("%10s", "-");
+	}
+	printf("\n");
+    }
+}
+
+/*
+ * printutil - prints the peak, average and integral utilization of 
+ *    each trace
+ */
+static void printutil(int n, stats_t *stats)
+{
+    int i;
+
+    printf("%5s%7s%7s%7s\n", "trace", "peak", "avg", "integ");
+    for (i = 0; i < n; i++) {
+	if (stats[i].valid)
+	    printf("%2d%9.0f%%%6.0f%%%6.0f%%\n", i, stats[i].util*100.0,
+		   stats[i].avg_util*100.0, stats[i].int_util*100.0);
+	else
+	    printf("%2d%10s%7s%7s\n", i, "-", "-", "-");
+    }
+}
+
+/*
+ * printwaste - prints where the bytes of the final heap are at the
+ *    peak of each trace, in percent of the final heap
+ */
+static void printwaste(int n, stats_t *stats)
+{
+    int i, w;
+
+    printf("%5s%11s%7s%7s%7s%7s%7s%7s%7s\n", "trace", "heap", "live", 
+	   "tags", "align", "slack", "free", "meta", "growth");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid || stats[i].heapsize <= 0 || 
+	    !allocator->walk) {
+	    printf("%2d%14s\n", i, "-");
+	    continue;
+	}
+	printf("%2d%14.0f", i, stats[i].heapsize);
+	for (w = 0; w < NWASTE; w++)
+	    printf("%6.1f%%", 100.0 * stats[i].waste[w] / stats[i].heapsize);
+	printf("\n");
+    }
+}
+
+/*
+ * printtouch - prints the throughput of each trace with and without 
+ *    payload touching, and the extra time and cache and TLB misses
+ *    per op that touching costs
+ */
+static void printtouch(int n, stats_t *stats)
+{
+    int i;
+    perfctr_t *a, *b;
+
+    printf("%5s%10s%10s%10s%13s%13s\n", "trace", "Kops", "touched", 
+	   "ns/op", "L1d-miss/op", "dTLB-miss/op");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid || stats[i].touch_secs <= 0) {
+	    printf("%2d%13s\n", i, "-");
+	    continue;
+	}
+	printf("%2d%13.0f%10.0f%10.1f", i, (stats[i].ops/1e3)/stats[i].secs,
+	       (stats[i].ops/1e3)/stats[i].touch_secs,
+	       (stats[i].touch_secs - stats[i].secs)*1e9/stats[i].ops);
+	a = &stats[i].perf;
+	b = &stats[i].touch_perf;
+	if (perf_counters && a->valid[PC_L1D_MISS] && b->valid[PC_L1D_MISS])
+	    printf("%13.2f", (b->count[PC_L1D_MISS] - a->count[PC_L1D_MISS]) 
+		   / stats[i].ops);
+	else
+	    printf("%13s", "-");
+	if (perf_counters && a->valid[PC_DTLB_MISS] && b->valid[PC_DTLB_MISS])
+	    printf("%13.2f", (b->count[PC_DTLB_MISS] - a->count[PC_DTLB_MISS])
+		   / stats[i].ops);
+	else
+	    printf("%13s", "-");
+	printf("\n");
+    }
+}
+
+/*
+ * writeresults - writes the per-trace results of one malloc package, 
+ *    including every timing sample, as CSV rows (one per sample) or as
+ *    a JSON object
+ */
+static void writeresults(FILE *fp, int json, char *name, int n, 
+			 char **tracefiles, stats_t *stats)
+{
+    int i, k;
+
+    if (json)
+	fprintf(fp, "    {\"allocator\": \"%s\", \"traces\": [\n", name);
+    for (i = 0; i < n; i++) {
+	if (json) {
+	    fprintf(fp, "      {\"trace\": %d, \"file\": \"%s\", \"valid\": %d, "
+		    "\"ops\": %.0f, \"util\": %.6f, \"secs\": [", 
+		    i, tracefiles[i], stats[i].valid, stats[i].ops, 
+		    stats[i].util);
+	    for (k = 0; k < stats[i].nsamples; k++)
+		fprintf(fp, "%s%.9f", k ? ", " : "", stats[i].samples[k]);
+	    fprintf(fp, "]}%s\n", i < n - 1 ? "," : "");
+	    continue;
+	}
+	if (!stats[i].valid) {
+	    fprintf(fp, "%s,%d,%s,0,%.0f,,,\n", name, i, tracefiles[i], 
+		    stats[i].ops);
+	    continue;
+	}
+	for (k = 0; k < stats[i].nsamples; k++)
+	    fprintf(fp, "%s,%d,%s,1,%.0f,%.6f,%d,%.9f\n", name, i, 
+		    tracefiles[i], stats[i].ops, stats[i].util, k, 
+		    stats[i].samples[k]);
+    }
+    if (json)
+	fprintf(fp, "    ]}");
+}
+
+/*
+ * cmp_double - qsort comparator for doubles
+ */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * median - returns the median of n values (n > 0)
+ */
+static double median(double *v, int n)
+{
+    double *tmp, m;
+
+    if ((tmp = (double *)malloc(n * sizeof(double))) == NULL)
+	unix_error("malloc failed in median");
+    memcpy(tmp, v, n * sizeof(double));
+    qsort(tmp, n, sizeof(double), cmp_double);
+    m = (n % 2) ? tmp[n/2] : (tmp[n/2 - 1] + tmp[n/2]) / 2;
+    free(tmp);
+    return m;
+}
+
 /* 
  * app_error - Report an arbitrary application error
  */
@@ -982,13 +2105,26 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvValbp] [-c <cpu>] [-f <file>] [-t <dir>] [-L <lib>] [-T <n>] [-n <runs>] [-o <file>]\n"
+	    "       [-u <file> [-i <ops>]] [-w <n>] [-D <file> [-d <ops>]]\n");
     fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-b         Break down the heap at the peak of each trace.\n");
+    fprintf(stderr, "\t-c <cpu>   Run the timed replays on CPU <cpu>.\n");
+    fprintf(stderr, "\t-D <file>  Write heap snapshots to <file> (see snapview).\n");
+    fprintf(stderr, "\t-d <ops>   Take them after these ops (e.g. 100,250 or %%50).\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-i <ops>   Ops between two utilization timeline samples.\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-L <lib>   Also evaluate the allocator plugin <lib> (repeatable).\n");
+    fprintf(stderr, "\t-n <runs>  Take <runs> timing samples per trace (median is used).\n");
+    fprintf(stderr, "\t-o <file>  Write results and samples to <file> (.csv or .json).\n");
+    fprintf(stderr, "\t-p         Collect hardware performance counters.\n");
+    fprintf(stderr, "\t-T <n>     Measure throughput with 1..<n> replay threads.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-u <file>  Write a utilization timeline (CSV) to <file>.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
+    fprintf(stderr, "\t-w <n>     Also time replays that touch every <n>th payload byte.\n");
 }
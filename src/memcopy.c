@@ -0,0 +1,143 @@
+/*
+ * memcopy.c - thresholded copy with streaming stores, see memcopy.h
+ *
+ * The vector loops align the destination, then copy 64 bytes per
+ * iteration: all four (or two) loads come before the stores, so a copy
+ * to a lower, overlapping address never overwrites source bytes it has
+ * not read yet. The unaligned head and the tail are left to memmove.
+ * The loops are compiled for their instruction set with the target
+ * attribute and only called after __builtin_cpu_supports says so, so
+ * the rest of the program (and -m32 builds) need no -mavx2.
+ */
+#include <string.h>
+
+#include "memcopy.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define MC_X86
+#include <immintrin.h>
+#endif
+
+#define PREFETCH_AHEAD 512  /* bytes of source prefetched ahead */
+
+static int best = -1;       /* path for large copies, -1 until known */
+
+#ifdef MC_X86
+/*
+ * copy_sse2 - 16-byte aligned d, n a multiple of 64
+ */
+__attribute__((target("sse2")))
+static void copy_sse2(char *d, const char *s, size_t n)
+{
+    __m128i a, b, c, e;
+
+    for (; n; n -= 64, d += 64, s += 64) {
+	_mm_prefetch(s + PREFETCH_AHEAD, _MM_HINT_T0);
+	a = _mm_loadu_si128((const __m128i *)s);
+	b = _mm_loadu_si128((const __m128i *)(s + 16));
+	c = _mm_loadu_si128((const __m128i *)(s + 32));
+	e = _mm_loadu_si128((const __m128i *)(s + 48));
+	_mm_stream_si128((__m128i *)d, a);
+	_mm_stream_si128((__m128i *)(d + 16), b);
+	_mm_stream_si128((__m128i *)(d + 32), c);
+	_mm_stream_si128((__m128i *)(d + 48), e);
+    }
+    _mm_sfence();
+}
+
+/*
+ * copy_avx2 - 32-byte aligned d, n a multiple of 64
+ */
+__attribute__((target("avx2")))
+static void copy_avx2(char *d, const char *s, size_t n)
+{
+    __m256i a, b;
+
+    for (; n; n -= 64, d += 64, s += 64) {
+	_mm_prefetch(s + PREFETCH_AHEAD, _MM_HINT_T0);
+	a = _mm256_loadu_si256((const __m256i *)s);
+	b = _mm256_loadu_si256((const __m256i *)(s + 32));
+	_mm256_stream_si256((__m256i *)d, a);
+	_mm256_stream_si256((__m256i *)(d + 32), b);
+    }
+    _mm_sfence();
+    _mm256_zeroupper();
+}
+#endif
+
+/*
+ * mem_copy_supported - does the CPU have the instructions of path?
+ */
+int mem_copy_supported(int path)
+{
+#ifdef MC_X86
+    __builtin_cpu_init();
+    switch (path) {
+    case MC_SSE2:
+	return __builtin_cpu_supports("sse2");
+    case MC_AVX2:
+	return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return path == MC_PLAIN;
+}
+
+/*
+ * mem_copy_best - the widest supported path, found once
+ */
+int mem_copy_best(void)
+{
+    if (best < 0)
+	best = mem_copy_supported(MC_AVX2) ? MC_AVX2 :
+	    mem_copy_supported(MC_SSE2) ? MC_SSE2 : MC_PLAIN;
+    return best;
+}
+
+/*
+ * mem_copy_name - short name of path
+ */
+const char *mem_copy_name(int path)
+{
+    static const char *names[MC_NPATHS] = {"plain", "sse2", "avx2"};
+
+    return path >= 0 && path < MC_NPATHS ? names[path] : "?";
+}
+
+/*
+ * mem_copy_path - copy n bytes with path, whatever n is
+ */
+void *mem_copy_path(int path, void *dst, const void *src, size_t n)
+{
+#ifdef MC_X86
+    char *d = dst;
+    const char *s = src;
+    size_t head, body, align = path == MC_AVX2 ? 32 : 16;
+
+    /* the loops cannot move upward into an overlapping range */
+    if (path != MC_PLAIN && !(d > s && d < s + n) && n >= 2 * align + 64) {
+	head = -(size_t)d & (align - 1);
+	memmove(d, s, head);
+	body = (n - head) & ~(size_t)63;
+	if (path == MC_AVX2)
+	    copy_avx2(d + head, s + head, body);
+	else
+	    copy_sse2(d + head, s + head, body);
+	memmove(d + head + body, s + head + body, n - head - body);
+	return dst;
+    }
+#endif
+    return memmove(dst, src, n);
+}
+
+/*
+ * mem_copy - memmove below MEMCOPY_NT_MIN bytes or onto itself,
+ *     streaming otherwise
+ */
+void *mem_copy(void *dst, const void *src, size_t n)
+{
+    /* a move onto itself would stream out the lines it just read */
+    if (n < MEMCOPY_NT_MIN || ((char *)src < (char *)dst + n &&
+			       (char *)dst < (char *)src + n))
+	return memmove(dst, src, n);
+    return mem_copy_path(mem_copy_best(), dst, src, n);
+}
@@ -0,0 +1,42 @@
+/*
+ * memcopy.h - payload copies for realloc
+ *
+ * mem_copy(dst, src, n) copies like memmove. Disjoint copies of
+ * MEMCOPY_NT_MIN bytes or more use streaming (non-temporal) stores, with
+ * the source prefetched ahead, so that relocating a large block does
+ * not evict the whole cache; smaller ones, and moves of a payload onto
+ * itself (realloc merging the previous block), are plain memmove. The
+ * vector path is picked on the first large copy from the CPU features:
+ * AVX2, else SSE2, else plain.
+ */
+#ifndef __MEMCOPY_H_
+#define __MEMCOPY_H_
+
+#include <stddef.h>
+
+#ifndef MEMCOPY_NT_MIN
+#define MEMCOPY_NT_MIN (2 << 20)  /* bytes; about the size of an L2 cache */
+#endif
+
+/* Copy paths for large copies */
+#define MC_PLAIN  0  /* memmove */
+#define MC_SSE2   1  /* 16-byte streaming stores */
+#define MC_AVX2   2  /* 32-byte streaming stores */
+#define MC_NPATHS 3
+
+/* Copy n bytes from src to dst, like memmove */
+void *mem_copy(void *dst, const void *src, size_t n);
+
+/* Copy n bytes with the given path, whatever the size (copybench) */
+void *mem_copy_path(int path, void *dst, const void *src, size_t n);
+
+/* Does this CPU have the path? */
+int mem_copy_supported(int path);
+
+/* The path mem_copy takes for large copies */
+int mem_copy_best(void);
+
+/* Short name of a path */
+const char *mem_copy_name(int path);
+
+#endif /* __MEMCOPY_H_ */
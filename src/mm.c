@@ -12,8 +12,9 @@
  *  - the number of seg-list is SEGLIST_COUNT(now 13)
  *  - each seglist contains several free blocks,
  *  - whose size are 2^4..2^5-1, 2^5..2^6-1, ... 2^15..2^16-1, 2^16..inf
- *  - there are SEGLIST_COUNT prolog blocks at the heap start,
- *  - and, also SEGLIST_COUNT epilog blocks at the heap end.
+ *  - long-lived blocks (mm_malloc_hint) have SEGLIST_COUNT seg-lists of their own
+ *  - there is a prolog block per seg-list at the heap start,
+ *  - and, also an epilog block per seg-list at the heap end.
  *  - between prologs and epilogs, there are N>=0 normal blocks.
  *
  * normal block structure
@@ -47,6 +48,7 @@
 
 #include "mm.h"
 #include "memlib.h"
+#include "memcopy.h"
 
 #define WSIZE   4   /* word size (bytes) */
 #define DSIZE   8   /* doubleword size (bytes) */
@@ -63,7 +65,8 @@
 #define PUT(p, val)  (*(size_t *)(p) = (val))
 
 /* Read the size and allocated fields from address p */
-#define GET_SIZE(p)  (GET(p) & ~0x7)
+/* (the size leaves out the LONG bit, see "lifetimes" below) */
+#define GET_SIZE(p)  (GET(p) & ~((size_t)0x7 | LONG_BIT))
 #define GET_ALLOC(p) (GET(p) & 0x1)
 
 /* Given block ptr bp, compute address of its header and footer */
@@ -93,6 +96,84 @@
 
 #define MIN_BLOCK_SIZE 16
 
+// realloc growth reservation
+// a block grown by realloc gets the GROWN bit in header and footer.
+// when a GROWN block grows again and has to move, it moves with a free
+// reserve of RESERVE(size) bytes right behind it, so that its next
+// growths take the reserve in place. reserves, and the remainders left
+// by growths in place, are free blocks with the GROWN bit, at the tail
+// of their seg-list: find_fit passes over them, and malloc reclaims
+// them only when nothing else fits.
+
+#define GROWN 0x4
+#define GET_GROWN(p) (GET(p) & GROWN)
+#define RESERVE(asize) ALIGN((asize) / 2)
+
+// realloc policy for a free block before the growing one (-DREALLOC_PREV=).
+// merging it costs a memmove of the payload, the same bytes the malloc
+// fallback copies, but it fills that hole instead of leaving the old
+// block behind to make it bigger. it is only taken when the block cannot
+// grow forward.
+#define PREV_NEVER  0   // grow forward, or move elsewhere
+#define PREV_FIT    1   // merge when prev (and next) hold the new size
+#define PREV_ALWAYS 2   // also let the last block merge before expanding
+#ifndef REALLOC_PREV
+#define REALLOC_PREV PREV_FIT
+#endif
+
+// directional splitting (-DSPLIT_SMALL=<bytes>)
+// malloc places a block at the low end of the free block it splits.
+// with SPLIT_SMALL, blocks smaller than that come from the high end
+// instead, so that small and large blocks, which tend to live for
+// different times, do not interleave. 0 turns it off.
+#ifndef SPLIT_SMALL
+#define SPLIT_SMALL 0
+#endif
+
+// lifetimes (mm_malloc_hint, -DLIFETIMES=2)
+// a block allocated with MM_HINT_LONG has the LONG bit, the top bit of
+// the size word, in header and footer, and when free it goes on a second
+// set of seg-lists, after the first. malloc looks for a fit among the
+// free blocks of its own lifetime. long-lived blocks take the heap
+// LONG_CHUNK bytes at a time, the rest of the chunk kept for the next
+// ones, so they are placed together. before expanding the heap, malloc
+// borrows a free block of the other lifetime, if one of LONG_CHUNK bytes
+// or more fits. free blocks of different lifetimes are not coalesced,
+// nor does realloc grow into one. so long-lived blocks do not pin the
+// holes left by short-lived ones. the default, 1, ignores the hints and
+// keeps the heap free of the second set of list heads.
+#ifndef LIFETIMES
+#define LIFETIMES 1
+#endif
+#if LIFETIMES > 1
+#define LONG_BIT ((size_t)1 << (sizeof(size_t) * 8 - 1))
+#else
+#define LONG_BIT ((size_t)0)
+#endif
+#define GET_LONG(p) (GET(p) & LONG_BIT)
+#ifndef LONG_CHUNK
+#define LONG_CHUNK (1<<10)
+#endif
+// free list of the size class no, for the lifetime life (0 or LONG_BIT)
+#define LIST_NO(life, no) ((no) + ((life) ? SEGLIST_COUNT : 0))
+
+// free list order (-DADDR_LISTS=<mask of seg-lists>)
+// the seg-lists whose bit is set keep their blocks in address order, so
+// find_fit does address-ordered first fit there, which fragments less
+// than LIFO on long runs. each of them is a skip list, to insert without
+// a linear walk: the forward pointer of level k of a block is its k-th
+// payload word (level 1 is SUCC), the upper levels of the heads are at
+// the heap start. the other seg-lists stay LIFO.
+#ifndef ADDR_LISTS
+#define ADDR_LISTS 0
+#endif
+#define SKIP_LEVELS 8
+#define ADDR_ORDERED(no) ((ADDR_LISTS >> (no) % SEGLIST_COUNT) & 1)
+// the heads of the address-ordered lists, in free list order
+#define ADDR_COUNT __builtin_popcount(ADDR_LISTS)
+#define ADDR_RANK(no) ((no) / SEGLIST_COUNT * ADDR_COUNT + \
+    __builtin_popcount(ADDR_LISTS & ((1 << (no) % SEGLIST_COUNT) - 1)))
+
 // below macros for the explicit free list
 
 // only for free blocks
@@ -105,16 +186,18 @@
 // in here, lists are 2^4.., 2^5.., ... 2^14...
 // the count must be odd number, as 8-byte alignment of block
 #define SEGLIST_COUNT 13
+// and as many again for long-lived blocks, the prologs then a word short
+#define LIST_COUNT (SEGLIST_COUNT * LIFETIMES)
 
 // if debug needed, enable this macro
 //#define DEBUG
 
-// each seglist has own epilogs and prologs
+// each free list has own epilogs and prologs
 // all the epilog & prologs are 3-WORD size
 // epilog has header, pred, succ of each seglist
 // prolog has footer, pred, succ of each seglist
 
-#define EPILOG_SIZE (SEGLIST_COUNT * 3 * WSIZE)
+#define EPILOG_SIZE (LIST_COUNT * 3 * WSIZE)
 #define PROLOG_SIZE (EPILOG_SIZE)
 
 // debug option
@@ -122,23 +205,109 @@
 #define BOLDSTART ""//"\033[1m"
 #define BOLDEND ""//"\033[0m"
 
-// global pointers
-static size_t *ptr_heap, heap_size;
+// allocator engines, chosen at compile time with -DMM_ENGINE=...
+// (make mdriver-buddy, ...), so there is no dispatch at run time
+#define MM_SEG    0   // segregated fits, as described above
+#define MM_BUDDY  1   // binary buddy system, see "buddy engine" below
+#define MM_HYBRID 2   // segregated fits, small requests in buddy arenas
+#ifndef MM_ENGINE
+#define MM_ENGINE MM_SEG
+#endif
 
-// seglist functions
+// buddy engine parameters
+#define BUDDY_TAG 0x2       // header bit of buddy blocks and buddy arenas
+#define BUDDY_MIN_ORDER 4   // 16-byte blocks: header, PRED, SUCC
+#define BUDDY_ORDERS 28     // free lists for orders below 28
+#ifndef ARENA_ORDER
+#define ARENA_ORDER 14      // hybrid: 16 KB buddy arenas...
+#endif
+#ifndef HYBRID_MAX_ORDER
+#define HYBRID_MAX_ORDER 9  // ...for requests that fit a 512-byte block
+#endif
+#ifndef BUDDY_ALIGN
+#define BUDDY_ALIGN 64      // buddy: blocks of 2^order bytes are aligned up to this
+#endif
+#define ARENA_SIZE ((size_t)1 << ARENA_ORDER)
+#define IS_ARENA(p) ((GET(p) & (BUDDY_TAG | GROWN)) == BUDDY_TAG)
+
+// quick lists (deferred coalescing)
+// a freed block of at most QUICK_MAX bytes is not coalesced, but pushed
+// on the quick list of its exact size: a LIFO chained through its first
+// payload word. it keeps looking allocated to its neighbours, with the
+// QUICK bits in header and footer, which no other block has. malloc of
+// that size pops it back without search or split. all quick blocks go
+// back to the seg-lists at once, coalesced, when they hold more than
+// QUICK_LIMIT bytes or when malloc finds no fit.
+#ifndef QUICK_MAX
+#define QUICK_MAX 64        // largest block size kept; 0: no quick lists
+#endif
+#ifndef QUICK_LIMIT
+#define QUICK_LIMIT 4096    // bytes held before consolidation
+#endif
+#define QUICK (BUDDY_TAG | GROWN)
+#define IS_QUICK(p) ((GET(p) & 0x7) == QUICK)
+#if QUICK_MAX
+#define QUICK_LISTS ((QUICK_MAX - MIN_BLOCK_SIZE) / DSIZE + 1)
+#else
+#define QUICK_LISTS 0
+#endif
+#define QUICK_BIN(size) (((size) - MIN_BLOCK_SIZE) / DSIZE)
 
-// determine the which seg-list the free block should go, considering its size.. 
-static int seglist_no(size_t v) {
-    // performs integer log 2
-    // (from 'Bit twiddling hacks' by Sean Anderson)
+#if MM_ENGINE == MM_HYBRID
+static void buddy_walk(char *base, size_t limit, mm_walk_fn f, void *arg);
+static void buddy_check(char *base, size_t limit);
+#endif
+
+// mm_free_sized checks the size it is given against the block in
+// DEBUG builds, or with -DCHECK_SIZED
+#if defined(DEBUG) && !defined(CHECK_SIZED)
+#define CHECK_SIZED
+#endif
+
+// event counters: compile with -DMM_STATS (make STATS=1) to keep them.
+// otherwise STAT_ADD expands to nothing and costs nothing.
+#ifdef MM_STATS
+static mm_stats_t stats;
+#define STAT_ADD(field, n) (stats.field += (n))
+#else
+#define STAT_ADD(field, n)
+#endif
+#define STAT_INC(field) STAT_ADD(field, 1)
+
+// integer log 2 of a 32-bit value
+// (from 'Bit twiddling hacks' by Sean Anderson)
+static int ilog2(size_t v) {
     size_t r, shift;
     r = (v > 0xFFFF)   << 4; v >>= r;
     shift = (v > 0xFF) << 3; v >>= shift; r |= shift;
     shift = (v > 0xF)  << 2; v >>= shift; r |= shift;
     shift = (v > 0x3)  << 1; v >>= shift; r |= shift;
                                           r |= (v >> 1);
+    return (int)r;
+}
+
+#if MM_ENGINE != MM_BUDDY
+
+// global pointers
+static size_t *ptr_heap, heap_size;
+#if QUICK_MAX
+static size_t **quick_heads;    // quick list heads, at the heap start
+static size_t quick_bytes;      // bytes held on the quick lists
+#endif
+
+// walk list number of the first quick list
+#if MM_ENGINE == MM_HYBRID
+#define QUICK_LIST0 (LIST_COUNT + BUDDY_ORDERS)
+#else
+#define QUICK_LIST0 LIST_COUNT
+#endif
+
+// seglist functions
+
+// determine the which seg-list the free block should go, considering its size.. 
+static int seglist_no(size_t v) {
     // seglist starts with 2^4..2^5-1, so 4 is index 0
-    int x = (int)r - 4;
+    int x = ilog2(v) - 4;
     if(x < 0) x = 0;
     if(x >= SEGLIST_COUNT) x = SEGLIST_COUNT - 1;
     return x;
@@ -148,10 +317,40 @@ static int seglist_no(size_t v) {
 #define get_overall_prolog_start() (ptr_heap)
 #define get_prolog_block(no) (get_overall_prolog_start() + (no) * 3)
 #define get_first_block(no) (*SUCCP(get_prolog_block(no)))
-#define get_overall_first_block() (get_overall_prolog_start() + (SEGLIST_COUNT * 3 + 1))
+#define get_overall_first_block() (get_overall_prolog_start() + (LIST_COUNT * 3 + 1))
 #define get_overall_epilog_start() ((size_t *)((char *)(ptr_heap) + ((heap_size) - EPILOG_SIZE)))
 #define get_epilog_block(no) (get_overall_epilog_start() + ((no) * 3 + 1))
 
+#if ADDR_LISTS
+static size_t **skip_heads;     // levels 2.. of the skip list heads
+
+// forward pointer of level k of bp, or of the head of list no if bp is NULL
+static size_t **skip_next(size_t *bp, int no, int k) {
+    if(bp)
+        return (size_t **)bp + k;
+    if(k == 1)
+        return SUCCP(get_prolog_block(no));
+    return &skip_heads[ADDR_RANK(no) * (SKIP_LEVELS - 1) + k - 2];
+}
+
+// levels of a free block: 1 + geometric (p = 1/4), hashed from its
+// address and capped by its payload words, so it needs no storing
+static int skip_level(size_t *bp) {
+    unsigned h = (unsigned)((size_t)bp / DSIZE);
+    int level = 1, cap = GET_SIZE(HDRP(bp)) / WSIZE - 3;
+
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    if(cap > SKIP_LEVELS) cap = SKIP_LEVELS;
+    while(level < cap && !(h & 3)) {
+        level++;
+        h >>= 2;
+    }
+    return level;
+}
+#endif
+
 // init seg-lists
 static void init_seglist() {
 #ifdef DEBUG
@@ -163,14 +362,14 @@ static void init_seglist() {
 
     // heap starts with prolog list
     // init prolog list
-    for(i=0; i<SEGLIST_COUNT; i++) {
+    for(i=0; i<LIST_COUNT; i++) {
         *p = 0; p++;
         *p = (size_t)(epi); p++;
         *p = 0; p++;
         epi += 3;
     }
     // init epilog list
-    for(i=0; i<SEGLIST_COUNT; i++) {
+    for(i=0; i<LIST_COUNT; i++) {
         *p = 0; p++;
         *p = (size_t)(pro); p++;
         *p = 0; p++;
@@ -178,9 +377,9 @@ static void init_seglist() {
     }
 #ifdef DEBUG
     p = ptr_heap;
-    for(i=0; i<SEGLIST_COUNT * 2; i++) {
-        printf("initialize %p(%s %d): %d %p %d\n", p+3*i, i/SEGLIST_COUNT ? "epilog" : "prolog",
-            i%SEGLIST_COUNT, *(p+3*i), *(p+3*i+1), *(p+3*i+2));
+    for(i=0; i<LIST_COUNT * 2; i++) {
+        printf("initialize %p(%s %d): %d %p %d\n", p+3*i, i/LIST_COUNT ? "epilog" : "prolog",
+            i%LIST_COUNT, *(p+3*i), *(p+3*i+1), *(p+3*i+2));
     }
 
     // test helper macros
@@ -245,10 +444,14 @@ void handle_error(size_t *bp, char *msg) {
 }
 
 // simple memory check function
-int mm_check(void) {
+static int seg_check(void) {
     // check all blocks are in free list is really free
     
     size_t *cur_block;
+#if QUICK_MAX
+    size_t quick_count = 0, quick_sum = 0;
+    int bin;
+#endif
 
     cur_block = get_overall_first_block(); // first block of block list
 
@@ -257,11 +460,21 @@ int mm_check(void) {
         // check if current block header and footer are same
         if(*HDRP(cur_block) != *FTRP(cur_block))
             handle_error(cur_block, "header and footer are mismatch");
+#if MM_ENGINE == MM_HYBRID
+        // check the blocks of a buddy arena
+        if(IS_ARENA(HDRP(cur_block)))
+            buddy_check((char *)cur_block + WSIZE, ARENA_SIZE);
+#endif
+#if QUICK_MAX
+        if(IS_QUICK(HDRP(cur_block)))
+            quick_count++;
+#endif
         if(GET_FREE_BIT(HDRP(cur_block))) {
-            // check coalescing
-            if(GET_FREE_BIT(GET_PREV_FTRP(cur_block)))
+            // check coalescing, of blocks of the same lifetime
+            size_t life = GET_LONG(HDRP(cur_block));
+            if(GET_FREE_BIT(GET_PREV_FTRP(cur_block)) && GET_LONG(GET_PREV_FTRP(cur_block)) == life)
                 handle_error(cur_block, "prev coalescing error");
-            if(GET_FREE_BIT(GET_NEXT_HDRP(cur_block)))
+            if(GET_FREE_BIT(GET_NEXT_HDRP(cur_block)) && GET_LONG(GET_NEXT_HDRP(cur_block)) == life)
                 handle_error(cur_block, "next coalescing error");
         }
         cur_block = NEXT_BLKP(cur_block);
@@ -269,15 +482,54 @@ int mm_check(void) {
 
     // loop in free list until epliog block
     int no;
-    for(no=0; no<SEGLIST_COUNT; no++) {
+    for(no=0; no<LIST_COUNT; no++) {
         cur_block = get_first_block(no); // first block of each free list
         while(*HDRP(cur_block)) {
             // check every block in the free list is really free
             if(!GET_FREE_BIT(HDRP(cur_block)))
                 handle_error(cur_block, "allocated block in free list");
+            if(LIST_NO(GET_LONG(HDRP(cur_block)), no % SEGLIST_COUNT) != no)
+                handle_error(cur_block, "block in the free list of the other lifetime");
             cur_block = *SUCCP(cur_block);
         }
     }
+
+#if ADDR_LISTS
+    // every level of an address-ordered list ascends, with blocks that tall
+    for(no=0; no<LIST_COUNT; no++) {
+        int k;
+        size_t *prev;
+        if(!ADDR_ORDERED(no))
+            continue;
+        for(k=1; k<=SKIP_LEVELS; k++) {
+            prev = NULL;
+            for(cur_block = *skip_next(NULL, no, k); cur_block && *HDRP(cur_block);
+                    cur_block = *skip_next(cur_block, no, k)) {
+                if(cur_block <= prev)
+                    handle_error(cur_block, "free list out of address order");
+                if(skip_level(cur_block) < k)
+                    handle_error(cur_block, "block above its skip list level");
+                prev = cur_block;
+            }
+        }
+    }
+#endif
+
+#if QUICK_MAX
+    // every quick block is on the quick list of its size, and only those
+    for(bin=0; bin<QUICK_LISTS; bin++) {
+        for(cur_block = quick_heads[bin]; cur_block; cur_block = *(size_t **)cur_block) {
+            if(!IS_QUICK(HDRP(cur_block)) || QUICK_BIN(GET_SIZE(HDRP(cur_block))) != bin)
+                handle_error(cur_block, "bad block in quick list");
+            quick_count--;
+            quick_sum += GET_SIZE(HDRP(cur_block));
+        }
+    }
+    if(quick_count)
+        handle_error(NULL, "quick block not in a quick list");
+    if(quick_sum != quick_bytes)
+        handle_error(NULL, "quick list byte count is wrong");
+#endif
     
     return 1;
 }
@@ -299,12 +551,100 @@ static int mm_dump(char *str, void *addr, int s)
     return mm_check();
 }
 
+// heap introspection
+
+// call f on every normal block, in address order
+static void seg_walk(mm_walk_fn f, void *arg) {
+    mm_block_t block;
+    size_t *cur_block = get_overall_first_block();
+
+    // loop in block list until first epliog block
+    while(*HDRP(cur_block)) {
+#if MM_ENGINE == MM_HYBRID
+        // report the blocks of a buddy arena instead of the arena
+        if(IS_ARENA(HDRP(cur_block))) {
+            buddy_walk((char *)cur_block + WSIZE, ARENA_SIZE, f, arg);
+            cur_block = NEXT_BLKP(cur_block);
+            continue;
+        }
+#endif
+        block.payload = cur_block;
+        block.size = GET_SIZE(HDRP(cur_block));
+        block.overhead = OVERHEAD;
+        block.free = GET_FREE_BIT(HDRP(cur_block));
+        block.list = block.free ? LIST_NO(GET_LONG(HDRP(cur_block)), seglist_no(block.size)) : -1;
+        if(IS_QUICK(HDRP(cur_block))) {
+            block.free = 1;
+            block.list = QUICK_LIST0 + QUICK_BIN(block.size);
+        }
+        f(&block, arg);
+        cur_block = NEXT_BLKP(cur_block);
+    }
+}
+
 // list functions
 
+#if ADDR_LISTS
+// insert a free block into the address-ordered seg-list no
+static void skip_insert(size_t *bp, int no) {
+    size_t **heads = skip_heads + ADDR_RANK(no) * (SKIP_LEVELS - 1);
+    size_t **link, *x = NULL, *next, *pred_free, *succ_free;
+    int k, level = skip_level(bp);
+
+    // x: the last block before bp, on each upper level from the top
+    for(k = SKIP_LEVELS; k >= 2; k--) {
+        link = x ? (size_t **)x + k : &heads[k - 2];
+        while((next = *link) && next < bp) {
+            x = next;
+            link = (size_t **)x + k;
+        }
+        if(k <= level) {
+            *((size_t **)bp + k) = next;
+            *link = bp;
+        }
+    }
+
+    // then on the seg-list itself, which ends with the epilog at the top
+    pred_free = x ? x : get_prolog_block(no);
+    while((succ_free = *SUCCP(pred_free)) < bp)
+        pred_free = succ_free;
+
+    *PREDP(bp) = pred_free;
+    *SUCCP(bp) = succ_free;
+
+    *SUCCP(pred_free) = bp;
+    *PREDP(succ_free) = bp;
+}
+
+// unlink a free block from the upper levels of the seg-list no
+static void skip_remove(size_t *bp, int no, int level) {
+    size_t **heads = skip_heads + ADDR_RANK(no) * (SKIP_LEVELS - 1);
+    size_t **link, *x = NULL, *next;
+    int k;
+
+    for(k = SKIP_LEVELS; k >= 2; k--) {
+        link = x ? (size_t **)x + k : &heads[k - 2];
+        while((next = *link) && next < bp) {
+            x = next;
+            link = (size_t **)x + k;
+        }
+        if(k <= level)
+            *link = *((size_t **)bp + k);
+    }
+}
+#endif
+
 // insert a free block into the seg-list, correspond to its size
 static void insert_to_free_list(size_t *bp) {
 
-    int which_list = seglist_no(GET_SIZE(HDRP(bp)));
+    int which_list = LIST_NO(GET_LONG(HDRP(bp)), seglist_no(GET_SIZE(HDRP(bp))));
+
+#if ADDR_LISTS
+    if(ADDR_ORDERED(which_list)) {
+        skip_insert(bp, which_list);
+        return;
+    }
+#endif
 
     // use LIFO strategy at seglist
     size_t *pred_free = get_prolog_block(which_list);
@@ -318,23 +658,72 @@ static void insert_to_free_list(size_t *bp) {
 
 }
 
-// remove a free block from seg-list
+// insert a free block at the tail of its seg-list, to be used last
+static void insert_to_free_list_tail(size_t *bp) {
+
+    int which_list = LIST_NO(GET_LONG(HDRP(bp)), seglist_no(GET_SIZE(HDRP(bp))));
+
+#if ADDR_LISTS
+    // address-ordered lists have no tail to keep
+    if(ADDR_ORDERED(which_list)) {
+        skip_insert(bp, which_list);
+        return;
+    }
+#endif
+
+    size_t *succ_free = get_epilog_block(which_list);
+    size_t *pred_free = *PREDP(succ_free);
+
+    *PREDP(bp) = pred_free;
+    *SUCCP(bp) = succ_free;
+
+    *SUCCP(pred_free) = bp;
+    *PREDP(succ_free) = bp;
+}
+
+// remove a free block from seg-list.
+// the list and the skip level are recomputed from the header, so a block
+// must be removed before its header (size or LONG bit) is rewritten
 static void remove_from_free_list(size_t *bp) {
 
     size_t *pred_free = *PREDP(bp);
     size_t *succ_free = *SUCCP(bp);
 
+#if ADDR_LISTS
+    int which_list = LIST_NO(GET_LONG(HDRP(bp)), seglist_no(GET_SIZE(HDRP(bp)))), level;
+
+    if(ADDR_ORDERED(which_list) && (level = skip_level(bp)) > 1)
+        skip_remove(bp, which_list, level);
+#endif
+
     *SUCCP(pred_free) = succ_free;
     *PREDP(succ_free) = pred_free;
 }   
 
 // function for heap initialization
-int mm_init(void) {
+static int seg_init(void) {
 
 #ifdef DEBUG
     dump_funcname("mm_init");
 #endif
 
+#if QUICK_MAX
+    // quick list heads, keeping the seg-list heap aligned
+    quick_heads = mem_sbrk(ALIGN(QUICK_LISTS * WSIZE));
+    memset(quick_heads, 0, QUICK_LISTS * WSIZE);
+    quick_bytes = 0;
+#endif
+
+#if ADDR_LISTS
+    // and the upper levels of the skip lists
+    skip_heads = mem_sbrk(ALIGN(LIFETIMES * ADDR_COUNT * (SKIP_LEVELS - 1) * WSIZE));
+    memset(skip_heads, 0, LIFETIMES * ADDR_COUNT * (SKIP_LEVELS - 1) * WSIZE);
+#endif
+
+    // the first block follows the prologs, an odd number of words
+    // keeps it 8-byte aligned (see SEGLIST_COUNT)
+    if(LIST_COUNT % 2 == 0)
+        mem_sbrk(WSIZE);
     heap_size = PROLOG_SIZE + EPILOG_SIZE;
     ptr_heap = mem_sbrk(heap_size);
 
@@ -352,27 +741,34 @@ static size_t get_adjusted_size(size_t size) {
 }
 
 
-// find first-fit of size, starting at seglist of start_no, working recursively.
+// find first-fit of size, starting at seglist of start_no, working recursively,
+// among the free blocks of lifetime life.
+// reserves are passed over; the first one that fits is the fallback.
 
-static void *find_fit(size_t size, int start_no) {
+static void *find_fit(size_t size, int start_no, size_t life, size_t *reserve) {
 
     if(start_no >= SEGLIST_COUNT)
-        return NULL; // no block found. expansion needed;
+        return reserve; // no block found. expansion needed, unless a reserve fits
 #ifdef DEBUG
     printf("finding fit(%d) in list %d\n", size, start_no);
 #endif
     // start at first block of free list
-    size_t *cur_block = get_first_block(start_no);
+    size_t *cur_block = get_first_block(LIST_NO(life, start_no));
 
     // loop until epliog block
     while(*HDRP(cur_block)) {
-        if(GET_FREE_BIT(HDRP(cur_block)) && GET_SIZE(HDRP(cur_block)) >= size)
-            return cur_block;
+        STAT_INC(visited);
+        if(GET_FREE_BIT(HDRP(cur_block)) && GET_SIZE(HDRP(cur_block)) >= size) {
+            if(!GET_GROWN(HDRP(cur_block)))
+                return cur_block;
+            if(!reserve)
+                reserve = cur_block;
+        }
         cur_block = *SUCCP(cur_block);
     }
 
     // if block is not found, search larger seglist
-    return find_fit(size, start_no + 1);
+    return find_fit(size, start_no + 1, life, reserve);
 }
 
 // expand heap & shift the epilogs
@@ -386,13 +782,15 @@ static void expand_heap(size_t size) {
     }
 
     heap_size += size;
+    STAT_INC(expansions);
+    STAT_ADD(expand_bytes, size);
     // first, move epilog
     memmove(new_epilog_start, old_epilog_start, EPILOG_SIZE);
 
     // update SUCC of epilog pred
     int i;
     size_t *each_epilog = new_epilog_start + 1;
-    for(i=0; i<SEGLIST_COUNT; i++) {
+    for(i=0; i<LIST_COUNT; i++) {
         *SUCCP(*PREDP(each_epilog)) = each_epilog;
         each_epilog += 3;
     }
@@ -401,15 +799,85 @@ static void expand_heap(size_t size) {
 #endif
 }
 
-// place the block
-static void place(size_t *addr, size_t size, int is_free) {
+// place the block, with the free bit and the LONG bit in flags
+static void place(size_t *addr, size_t size, size_t flags) {
     // place block header and footer
-    PUT(HDRP(addr), PACK(size, is_free));
-    PUT(FTRP(addr), PACK(size, is_free));
+    PUT(HDRP(addr), PACK(size, flags));
+    PUT(FTRP(addr), PACK(size, flags));
 }
 
-// our malloc function: find fit, then alloc or split-alloc or expand
-void *mm_malloc(size_t size) {
+// mark an allocated block as grown by realloc, or a free block as a reserve
+static void set_grown(size_t *bp) {
+    PUT(HDRP(bp), GET(HDRP(bp)) | GROWN);
+    PUT(FTRP(bp), GET(FTRP(bp)) | GROWN);
+}
+
+// cut the grown block bp down to asize, leaving the rest behind it as a
+// reserve at the tail of its seg-list
+static void leave_reserve(size_t *bp, size_t asize) {
+    size_t size = GET_SIZE(HDRP(bp)), life = GET_LONG(HDRP(bp));
+    size_t *reserve, *next;
+
+    if(size - asize >= MIN_BLOCK_SIZE) {
+        place(bp, asize, life);
+        reserve = NEXT_BLKP(bp);
+        size -= asize;
+        place(reserve, size, life | 1);
+        // the old block may have been freed right behind it
+        if(GET_FREE_BIT(GET_NEXT_HDRP(reserve)) && GET_LONG(GET_NEXT_HDRP(reserve)) == life) {
+            next = NEXT_BLKP(reserve);
+            remove_from_free_list(next);
+            size += GET_SIZE(HDRP(next));
+            place(reserve, size, life | 1);
+        }
+        set_grown(reserve);
+        insert_to_free_list_tail(reserve);
+    }
+    set_grown(bp);
+}
+
+#if QUICK_MAX
+static void coalesce_free(void *ptr);
+
+// hold a freed small block on the quick list of its size
+static void quick_push(size_t *bp, size_t size) {
+    size_t **head = &quick_heads[QUICK_BIN(size)];
+
+    PUT(HDRP(bp), PACK(size, QUICK));
+    PUT(FTRP(bp), PACK(size, QUICK));
+    *(size_t **)bp = *head;
+    *head = bp;
+    quick_bytes += size;
+}
+
+// consolidation: free every quick block into the seg-lists, coalesced.
+// oldest first, so that the seg-lists end up as if freed right away
+static void quick_flush(void) {
+    size_t *bp, *next, *old;
+    int bin;
+
+    STAT_INC(consolidations);
+    for(bin=0; bin<QUICK_LISTS; bin++) {
+        // reverse the list
+        old = NULL;
+        for(bp = quick_heads[bin]; bp; bp = next) {
+            next = *(size_t **)bp;
+            *(size_t **)bp = old;
+            old = bp;
+        }
+        quick_heads[bin] = NULL;
+        for(bp = old; bp; bp = next) {
+            next = *(size_t **)bp;
+            coalesce_free(bp);
+        }
+    }
+    quick_bytes = 0;
+}
+#endif
+
+// our malloc function: find fit, then alloc or split-alloc or expand.
+// life is the lifetime of the block, 0 or LONG_BIT
+static void *seg_malloc(size_t size, size_t life) {
 
 #ifdef DEBUG
     dump_funcname("mm_malloc");
@@ -425,18 +893,59 @@ void *mm_malloc(size_t size) {
     printf("size: %d -> %d\n", size, asize);
 #endif
 
+#if QUICK_MAX
+    // a quick block of the exact size is taken as it is
+    if(!life && asize <= QUICK_MAX && (bp = quick_heads[QUICK_BIN(asize)])) {
+        STAT_INC(quick_hits);
+        quick_heads[QUICK_BIN(asize)] = *(size_t **)bp;
+        quick_bytes -= asize;
+        place(bp, asize, 0);
+        return bp;
+    }
+#endif
+
     // find fit, starting smallest possible seglist
-    if((bp = find_fit(asize, seglist_no(asize)))) {
+    STAT_INC(searches);
+    bp = find_fit(asize, seglist_no(asize), life, NULL);
+#if QUICK_MAX
+    // consolidate the quick blocks before expanding the heap, if they
+    // could make a fit
+    if(!bp && quick_bytes >= asize) {
+        quick_flush();
+        bp = find_fit(asize, seglist_no(asize), life, NULL);
+    }
+#endif
+#if LIFETIMES > 1
+    // then borrow a large free block of the other lifetime
+    if(!bp)
+        bp = find_fit(MAX(asize, LONG_CHUNK), seglist_no(MAX(asize, LONG_CHUNK)), life ^ LONG_BIT, NULL);
+#endif
+    if(bp) {
         // if fit is found
         remove_from_free_list(bp);
         // check whether splitting is possible  
         size_t block_size = GET_SIZE(HDRP(bp));
+        // the remainder keeps the lifetime of the free block
+        size_t rest_life = GET_LONG(HDRP(bp));
         if(block_size - asize >= MIN_BLOCK_SIZE) {
 
             // case: split
-            place(bp, asize, 0);
-            size_t * free_area = NEXT_BLKP(bp);
-            place(free_area, block_size - asize, 1);
+            STAT_INC(splits);
+            size_t * free_area;
+#if SPLIT_SMALL
+            if(asize < SPLIT_SMALL) {
+                // small request: carve it from the high end
+                free_area = bp;
+                place(free_area, block_size - asize, rest_life | 1);
+                bp = NEXT_BLKP(free_area);
+                place(bp, asize, life);
+            } else
+#endif
+            {
+                place(bp, asize, life);
+                free_area = NEXT_BLKP(bp);
+                place(free_area, block_size - asize, rest_life | 1);
+            }
             insert_to_free_list(free_area);
 
 #ifdef DEBUG
@@ -447,7 +956,7 @@ void *mm_malloc(size_t size) {
 
         } else {
             // non-split
-            place(bp, block_size, 0);
+            place(bp, block_size, life);
 #ifdef DEBUG
             printf("found fit at %p: %d of %d\n", bp, block_size, asize);
             dump_extra(bp);
@@ -460,20 +969,30 @@ void *mm_malloc(size_t size) {
 #ifdef DEBUG
         printf("try expansion...\n");
 #endif 
-        // if last block is free area
-        if(GET_FREE_BIT(get_overall_epilog_start() - 1)) {
+        // long-lived blocks take the heap a chunk at a time, so that
+        // the next ones are placed next to them
+        size_t grow = life && asize + MIN_BLOCK_SIZE <= LONG_CHUNK ? LONG_CHUNK : asize;
+
+        // if last block is free area, of this lifetime
+        size_t *last_ftrp = get_overall_epilog_start() - 1;
+        if(GET_FREE_BIT(last_ftrp) && GET_LONG(last_ftrp) == life) {
             bp = get_overall_last_block();
             remove_from_free_list(bp);
             size_t last_block_size = GET_SIZE(HDRP(bp));
-            expand_heap(asize - last_block_size);
+            expand_heap(grow - last_block_size);
         } else {
             // set bp at the position of old epilog
             bp = get_overall_epilog_start() + 1;
-            expand_heap(asize);
+            expand_heap(grow);
         }
 
-        // set the new block at bp
-        place(bp, asize, 0);
+        // set the new block at bp, and the rest of a chunk behind it
+        place(bp, asize, life);
+        if(grow > asize) {
+            size_t *free_area = NEXT_BLKP(bp);
+            place(free_area, grow - asize, life | 1);
+            insert_to_free_list(free_area);
+        }
     }
 
 #ifdef DEBUG
@@ -484,17 +1003,124 @@ void *mm_malloc(size_t size) {
 
 }
 
-// our free function: with coalescing
-void mm_free(void *ptr)
+// aligned allocation (mm_memalign)
+// the payload of bp is moved up to the next multiple of align, far
+// enough for the bytes before it to make a free block of their own
+static size_t aligned_lead(size_t *bp, size_t align) {
+    size_t lead = -(size_t)bp & (align - 1);
+
+    while(lead && lead < MIN_BLOCK_SIZE)
+        lead += align;
+    return lead;
+}
+
+// first fit for asize bytes at an aligned payload, among the short-lived
+// free blocks. reserves are passed over
+static size_t *find_aligned_fit(size_t asize, size_t align) {
+    size_t *bp;
+    int no;
+
+    for(no = seglist_no(asize); no < SEGLIST_COUNT; no++) {
+        for(bp = get_first_block(no); *HDRP(bp); bp = *SUCCP(bp)) {
+            STAT_INC(visited);
+            if(GET_FREE_BIT(HDRP(bp)) && !GET_GROWN(HDRP(bp)) &&
+               GET_SIZE(HDRP(bp)) >= aligned_lead(bp, align) + asize)
+                return bp;
+        }
+    }
+    return NULL;
+}
+
+// allocate asize bytes at the aligned payload of the free block bp, which
+// is off the lists. the lead before it and the rest behind it, if large
+// enough, go back to the free lists
+static size_t *place_aligned(size_t *bp, size_t asize, size_t align) {
+    size_t size = GET_SIZE(HDRP(bp));
+    size_t lead = aligned_lead(bp, align);
+    size_t *free_area;
+
+    if(lead) {
+        STAT_INC(splits);
+        place(bp, lead, 1);
+        insert_to_free_list(bp);
+        bp = (size_t *)((char *)bp + lead);
+        size -= lead;
+    }
+    if(size - asize >= MIN_BLOCK_SIZE) {
+        STAT_INC(splits);
+        place(bp, asize, 0);
+        free_area = NEXT_BLKP(bp);
+        place(free_area, size - asize, 1);
+        insert_to_free_list(free_area);
+    } else
+        place(bp, size, 0);
+    return bp;
+}
+
+// malloc with the payload aligned to align, a power of two. every payload
+// is DSIZE aligned, and a quick block goes back out where it was freed,
+// so an aligned one serves the size again. otherwise the first free
+// block with room for the lead is cut around the payload
+static void *seg_memalign(size_t align, size_t size) {
+    size_t asize, grow, last_size;
+    size_t *bp;
+
+    if(align <= DSIZE || size == 0)
+        return seg_malloc(size, 0);
+    asize = get_adjusted_size(size);
+
+#if QUICK_MAX
+    if(asize <= QUICK_MAX && (bp = quick_heads[QUICK_BIN(asize)]) &&
+       !((size_t)bp & (align - 1)))
+        return seg_malloc(size, 0);
+#endif
+
+    STAT_INC(searches);
+    bp = find_aligned_fit(asize, align);
+#if QUICK_MAX
+    if(!bp && quick_bytes >= asize) {
+        quick_flush();
+        bp = find_aligned_fit(asize, align);
+    }
+#endif
+    if(bp) {
+        remove_from_free_list(bp);
+        return place_aligned(bp, asize, align);
+    }
+
+    // expand the heap by enough for the block and any lead
+    grow = asize + align + MIN_BLOCK_SIZE;
+    size_t *last_ftrp = get_overall_epilog_start() - 1;
+    if(GET_FREE_BIT(last_ftrp) && !GET_LONG(last_ftrp)) {
+        bp = get_overall_last_block();
+        remove_from_free_list(bp);
+        // the last block may be a reserve, which is not searched
+        last_size = GET_SIZE(HDRP(bp));
+        if(last_size < grow)
+            expand_heap(grow - last_size);
+        else
+            grow = last_size;
+    } else {
+        bp = get_overall_epilog_start() + 1;
+        expand_heap(grow);
+    }
+    place(bp, grow, 1);
+    return place_aligned(bp, asize, align);
+}
+
+// free a block into the seg-lists, with coalescing
+static void coalesce_free(void *ptr)
 {
     size_t *bp = (size_t *)ptr;
 
     size_t size = GET_SIZE(HDRP(bp));
+    size_t life = GET_LONG(HDRP(bp)), flags = life | 1;
 
-    place(ptr, size, 1);
+    place(ptr, size, flags);
 
-    size_t prev_free = GET_FREE_BIT(GET_PREV_FTRP(bp));
-    size_t next_free = GET_FREE_BIT(GET_NEXT_HDRP(bp));
+    // only free blocks of the same lifetime are merged
+    size_t prev_free = GET_FREE_BIT(GET_PREV_FTRP(bp)) && GET_LONG(GET_PREV_FTRP(bp)) == life;
+    size_t next_free = GET_FREE_BIT(GET_NEXT_HDRP(bp)) && GET_LONG(GET_NEXT_HDRP(bp)) == life;
 
     size_t *prev_block = PREV_BLKP(bp);
     size_t *next_block = NEXT_BLKP(bp);
@@ -511,22 +1137,25 @@ void mm_free(void *ptr)
 
     // coalesce blocks
     if(prev_free && next_free) {
+        STAT_INC(coalesce_both);
         remove_from_free_list(prev_block);
         remove_from_free_list(next_block);
         size += GET_SIZE(GET_PREV_FTRP(bp)) + GET_SIZE(GET_NEXT_HDRP(bp));
-        PUT(FTRP(NEXT_BLKP(bp)), PACK(size, 1));
-        PUT(HDRP(PREV_BLKP(bp)), PACK(size, 1));
+        PUT(FTRP(NEXT_BLKP(bp)), PACK(size, flags));
+        PUT(HDRP(PREV_BLKP(bp)), PACK(size, flags));
         bp = PREV_BLKP(bp);
     } else if(!prev_free && next_free) { 
+        STAT_INC(coalesce_next);
         remove_from_free_list(next_block);
         size += GET_SIZE(GET_NEXT_HDRP(bp));
-        PUT(FTRP(NEXT_BLKP(bp)), PACK(size, 1));
-        PUT(HDRP(bp), PACK(size, 1));
+        PUT(FTRP(NEXT_BLKP(bp)), PACK(size, flags));
+        PUT(HDRP(bp), PACK(size, flags));
     } else if(prev_free && !next_free) {
+        STAT_INC(coalesce_prev);
         remove_from_free_list(prev_block);
         size += GET_SIZE(GET_PREV_FTRP(bp));
-        PUT(FTRP(bp), PACK(size, 1));
-        PUT(HDRP(PREV_BLKP(bp)), PACK(size, 1));
+        PUT(FTRP(bp), PACK(size, flags));
+        PUT(HDRP(PREV_BLKP(bp)), PACK(size, flags));
         bp = PREV_BLKP(bp);
     }
 
@@ -540,24 +1169,66 @@ void mm_free(void *ptr)
 #endif
 }
 
+// our free function: small blocks wait on the quick lists, coalesced later
+static void seg_free(void *ptr)
+{
+#if QUICK_MAX
+    size_t size = GET_SIZE(HDRP(ptr));
+
+    if(size <= QUICK_MAX && !GET_LONG(HDRP(ptr))) {
+        quick_push(ptr, size);
+        if(quick_bytes > QUICK_LIMIT)
+            quick_flush();
+        return;
+    }
+#endif
+    coalesce_free(ptr);
+}
+
+// payload bytes of an allocated block, which may be more than requested
+static size_t seg_usable_size(void *ptr)
+{
+    return GET_SIZE(HDRP(ptr)) - DSIZE;
+}
+
+// free a block of known payload size. the header stays the authority:
+// a block may be larger than its size asks for, so the size is only
+// checked against it
+static void seg_free_sized(void *ptr, size_t size)
+{
+#ifdef CHECK_SIZED
+    // an allocated block is its adjusted size, plus an unsplit rest of
+    // less than a block
+    size_t asize = get_adjusted_size(size);
+    size_t block_size = GET_SIZE(HDRP(ptr));
+    if(asize > block_size || block_size - asize >= MIN_BLOCK_SIZE)
+        handle_error(ptr, "mm_free_sized: size does not match the block");
+#endif
+    seg_free(ptr);
+}
+
 // our realloc function: try utilizing next block & autonomous heap expansion
-void *mm_realloc(void *ptr, size_t size)
+static void *seg_realloc(void *ptr, size_t size)
 {
 #ifdef DEBUG
     dump_funcname("mm_realloc");
 #endif
 
     // if ptr == NULL, malloc
-    if(!ptr) return mm_malloc(size);
+    if(!ptr) return seg_malloc(size, 0);
     
     // if size == 0, free
     if(!size) {
-        mm_free(ptr);
+        seg_free(ptr);
         return NULL;
     }
 
     size_t asize = get_adjusted_size(size);
     size_t cur_size = GET_SIZE(HDRP(ptr));
+    size_t growing = asize > cur_size;
+    size_t life = GET_LONG(HDRP(ptr));
+
+    STAT_INC(reallocs);
 
     void * oldptr = ptr;
 
@@ -565,11 +1236,9 @@ void *mm_realloc(void *ptr, size_t size)
     printf("realloc %p(%d -> %d)\n", ptr, cur_size, asize);
 #endif
 
-    // first check whether surrounding free blocks exist
+    // first check whether surrounding free blocks (of its lifetime) exist
 
-    // no utilizing with prev block.. it hinders overall utilization rate
-    size_t prev_free = 0;//GET_FREE_BIT(GET_PREV_FTRP(ptr));
-    size_t next_free = GET_FREE_BIT(GET_NEXT_HDRP(ptr));
+    size_t next_free = GET_FREE_BIT(GET_NEXT_HDRP(ptr)) && GET_LONG(GET_NEXT_HDRP(ptr)) == life;
 
     size_t prev_size = GET_SIZE(GET_PREV_FTRP(ptr));
     size_t next_size = GET_SIZE(GET_NEXT_HDRP(ptr));
@@ -581,6 +1250,12 @@ void *mm_realloc(void *ptr, size_t size)
 
     // check is expandable block..
     size_t is_last = get_overall_last_block() == ptr;
+
+    // utilize prev block only by REALLOC_PREV, and when next is not enough
+    size_t fwd_size = cur_size + (next_free ? next_size : 0);
+    size_t prev_free = REALLOC_PREV != PREV_NEVER &&
+        GET_FREE_BIT(GET_PREV_FTRP(ptr)) && GET_LONG(GET_PREV_FTRP(ptr)) == life && fwd_size < asize &&
+        (is_last ? REALLOC_PREV == PREV_ALWAYS : prev_size + fwd_size >= asize);
     
     // data size to copy/move
     size_t data_size = (asize < cur_size ? asize : cur_size) - DSIZE;
@@ -589,7 +1264,9 @@ void *mm_realloc(void *ptr, size_t size)
         total_size = prev_size + cur_size + next_size;
         remove_from_free_list(prev_block);
         remove_from_free_list(next_block);
-        ptr = memmove(prev_block, ptr, data_size);        
+        ptr = mem_copy(prev_block, ptr, data_size);        
+        STAT_INC(realloc_prev);
+        STAT_ADD(moved_bytes, data_size);
     } else if(!prev_free && next_free && (cur_size + next_size >= asize || is_last)) {
         // utilize next side 
         total_size = cur_size + next_size;
@@ -598,18 +1275,32 @@ void *mm_realloc(void *ptr, size_t size)
         // utilize prev side
         total_size = prev_size + cur_size;
         remove_from_free_list(prev_block);
-        ptr = memmove(prev_block, ptr, data_size);        
+        ptr = mem_copy(prev_block, ptr, data_size);        
+        STAT_INC(realloc_prev);
+        STAT_ADD(moved_bytes, data_size);
     } else if(!prev_free && !next_free && (cur_size >= asize || is_last)) {
         total_size = cur_size;
+    } else if(growing && GET_GROWN(HDRP(ptr))) {
+        // grown before: move, with a reserve for the next growths
+        size_t *temp = seg_malloc(asize + RESERVE(asize) - DSIZE, life);
+        mem_copy(temp, ptr, data_size);
+        STAT_ADD(copied_bytes, data_size);
+        seg_free(ptr);
+        leave_reserve(temp, asize);
+
+        return temp;
     } else {
         // in this case, we will use simply malloc & free.. 
-        size_t *temp = mm_malloc(asize);
-        memcpy(temp, ptr, data_size);
-        mm_free(ptr);
+        size_t *temp = seg_malloc(size, life);
+        mem_copy(temp, ptr, data_size);
+        STAT_ADD(copied_bytes, data_size);
+        seg_free(ptr);
+        if(growing) set_grown(temp);
 
         return temp;
     }
 
+    STAT_INC(realloc_fast);
     if(total_size < asize) {
         if(!is_last) {
             handle_error(ptr, "Illegal condition check in realloc");
@@ -618,7 +1309,8 @@ void *mm_realloc(void *ptr, size_t size)
         // expand the heap
         expand_heap(asize - total_size);
 
-        place(ptr, asize, 0);
+        place(ptr, asize, life);
+        set_grown(ptr);
         new_block = NULL;
     } else {
 
@@ -627,18 +1319,25 @@ void *mm_realloc(void *ptr, size_t size)
         // determine to split
         if(new_block_size >= MIN_BLOCK_SIZE) {
             // split
+            STAT_INC(splits);
             // set header & footer
-            place(ptr, asize, 0);
+            place(ptr, asize, life);
 
             // set new block
             new_block = FTRP(ptr) + 2;
-            place(new_block, new_block_size, 1);
-            insert_to_free_list(new_block);
+            place(new_block, new_block_size, life | 1);
+            // keep what a growth leaves over as a reserve
+            if(growing) {
+                set_grown(new_block);
+                insert_to_free_list_tail(new_block);
+            } else
+                insert_to_free_list(new_block);
         } else {
             // non-split
-            place(ptr, total_size, 0);
+            place(ptr, total_size, life);
             new_block = NULL;
         }
+        if(growing) set_grown(ptr);
     }
 
 #ifdef DEBUG
@@ -658,3 +1357,717 @@ void *mm_realloc(void *ptr, size_t size)
 
     return ptr;
 }
+
+#endif /* MM_ENGINE != MM_BUDDY */
+
+#if MM_ENGINE == MM_BUDDY
+// function for error handling
+void handle_error(size_t *bp, char *msg) {
+    printf("<<<<<<%s>>>>>>\n", msg);
+    exit(1);
+}
+#endif
+
+#if MM_ENGINE != MM_SEG
+
+// buddy engine
+//
+// a block is 2^order bytes (order >= BUDDY_MIN_ORDER) at an offset from
+// the base of its region that is a multiple of its size, so the buddy
+// of the block at offset off is at off ^ 2^order: splitting and merging
+// need no footers and no walks. a block has a one-word header holding
+// its offset (in units of the minimum block), order, BUDDY_TAG and the
+// free bit; the payload follows. free blocks keep PRED and SUCC there,
+// on one NULL-terminated list per order. the list heads are the first
+// words of the heap.
+//
+// the buddy engine has a single region that starts after the list heads
+// and grows at its frontier. the hybrid engine puts requests that fit
+// 2^HYBRID_MAX_ORDER bytes into buddy arenas of ARENA_SIZE bytes, which
+// are allocated seg-list blocks with BUDDY_TAG in header and footer, and
+// gives an arena back to the seg-lists once all of it is free again.
+// mm_free tells buddy blocks from seg-list blocks by BUDDY_TAG.
+
+#define BUDDY_MIN ((size_t)1 << BUDDY_MIN_ORDER)
+
+#define BUDDY_PACK(off, order, free) \
+    ((off) / BUDDY_MIN << 8 | (size_t)(order) << 3 | BUDDY_TAG | (free))
+#define BUDDY_OFF(bp)   ((GET(HDRP(bp)) >> 8) * BUDDY_MIN)
+#define BUDDY_ORDER(bp) ((int)(GET(HDRP(bp)) >> 3) & 0x1f)
+#define BUDDY_FREE(bp)  GET_FREE_BIT(HDRP(bp))
+
+// the list heads
+static size_t **buddy_heads;
+
+#if MM_ENGINE == MM_BUDDY
+// the region: blocks from offset 0 to the frontier, which only grows
+static char *buddy_base;
+static size_t buddy_frontier;
+#define REGION_LIMIT buddy_frontier
+#define REGION_ORDER (BUDDY_ORDERS - 1)
+#else
+#define REGION_LIMIT ARENA_SIZE
+#define REGION_ORDER ARENA_ORDER
+#endif
+
+// smallest order whose blocks hold size bytes
+static int buddy_order(size_t size) {
+    if(size <= BUDDY_MIN) return BUDDY_MIN_ORDER;
+    return ilog2(size - 1) + 1;
+}
+
+// write the header of the block at offset off of the region at base
+static size_t *buddy_block(char *base, size_t off, int order, int is_free) {
+    size_t *bp = (size_t *)(base + off + WSIZE);
+    PUT(HDRP(bp), BUDDY_PACK(off, order, is_free));
+    return bp;
+}
+
+// push a free block on the list of its order (LIFO)
+static void buddy_push(size_t *bp, int order) {
+    size_t *head = buddy_heads[order];
+
+    *PREDP(bp) = NULL;
+    *SUCCP(bp) = head;
+    if(head) *PREDP(head) = bp;
+    buddy_heads[order] = bp;
+}
+
+// remove a free block from the list of its order
+static void buddy_unlink(size_t *bp, int order) {
+    size_t *pred = *PREDP(bp), *succ = *SUCCP(bp);
+
+    if(pred) *SUCCP(pred) = succ;
+    else buddy_heads[order] = succ;
+    if(succ) *PREDP(succ) = pred;
+}
+
+// the buddy of the block at offset off, if it is free and whole
+static size_t *free_buddy(char *base, size_t off, int order) {
+    size_t size = (size_t)1 << order, boff = off ^ size;
+    size_t *buddy;
+
+    if(order >= REGION_ORDER || boff + size > REGION_LIMIT)
+        return NULL;
+    buddy = (size_t *)(base + boff + WSIZE);
+    if(!BUDDY_FREE(buddy) || BUDDY_ORDER(buddy) != order)
+        return NULL;
+    return buddy;
+}
+
+// free a block, merging it with its buddies as far as they are free
+static void buddy_release(size_t *bp) {
+    int order = BUDDY_ORDER(bp);
+    size_t off = BUDDY_OFF(bp);
+    char *base = (char *)HDRP(bp) - off;
+    size_t *buddy;
+
+    while((buddy = free_buddy(base, off, order))) {
+        buddy_unlink(buddy, order);
+        if(off & ((size_t)1 << order)) {
+            STAT_INC(coalesce_prev);
+            off ^= (size_t)1 << order;
+        } else
+            STAT_INC(coalesce_next);
+        order++;
+    }
+#if MM_ENGINE == MM_HYBRID
+    if(order == ARENA_ORDER) {
+        // the whole arena is free: give it back
+        seg_free(base - WSIZE);
+        return;
+    }
+#endif
+    buddy_push(buddy_block(base, off, order, 1), order);
+}
+
+#if MM_ENGINE == MM_BUDDY
+// grow the region toward a free block of the given order: first free
+// blocks that align the frontier to the order, one per call, as large as
+// the frontier alignment allows (they merge with free blocks below), then
+// a block of the order itself. returns -1 if out of memory.
+static int buddy_expand(int order) {
+    size_t size = (size_t)1 << order;
+
+    if(buddy_frontier & (size - 1))
+        size = buddy_frontier & -buddy_frontier;
+    if(mem_sbrk(size) == (void *)-1)
+        return -1;
+    STAT_INC(expansions);
+    STAT_ADD(expand_bytes, size);
+    buddy_block(buddy_base, buddy_frontier, ilog2(size), 0);
+    buddy_frontier += size;
+    buddy_release((size_t *)(buddy_base + buddy_frontier - size + WSIZE));
+    return 0;
+}
+#else
+// allocate a new arena from the seg-lists, as one free block
+static int buddy_expand(int order) {
+    size_t *ap = seg_malloc(ARENA_SIZE + WSIZE, 0);
+
+    if(!ap)
+        return -1;
+    STAT_INC(expansions);
+    STAT_ADD(expand_bytes, ARENA_SIZE);
+    PUT(HDRP(ap), GET(HDRP(ap)) | BUDDY_TAG);
+    PUT(FTRP(ap), GET(FTRP(ap)) | BUDDY_TAG);
+    buddy_push(buddy_block((char *)ap + WSIZE, 0, ARENA_ORDER, 1), ARENA_ORDER);
+    return 0;
+}
+#endif
+
+// find the smallest free block that fits, splitting it down as needed
+static void *buddy_malloc(size_t size) {
+    int order = buddy_order(size + WSIZE), j;
+    size_t *bp;
+    size_t off;
+    char *base;
+
+    if(order > REGION_ORDER)
+        return NULL;
+    STAT_INC(searches);
+    for(;;) {
+        for(j = order; j <= REGION_ORDER && !buddy_heads[j]; j++)
+            STAT_INC(visited);
+        if(j <= REGION_ORDER)
+            break;
+        if(buddy_expand(order) < 0)
+            return NULL;
+    }
+
+    bp = buddy_heads[j];
+    buddy_unlink(bp, j);
+    off = BUDDY_OFF(bp);
+    base = (char *)HDRP(bp) - off;
+    // the upper halves go back as free blocks
+    while(j > order) {
+        j--;
+        STAT_INC(splits);
+        buddy_push(buddy_block(base, off + ((size_t)1 << j), j, 1), j);
+    }
+    buddy_block(base, off, order, 0);
+    return bp;
+}
+
+// grow a block in place while it is the lower half of a block whose
+// upper half is free (or, in the buddy engine, past the frontier);
+// otherwise move it
+static void *buddy_realloc(size_t *bp, size_t size) {
+    int order = BUDDY_ORDER(bp), need = buddy_order(size + WSIZE), o;
+    size_t off = BUDDY_OFF(bp), grow = 0, half;
+    char *base = (char *)HDRP(bp) - off;
+    size_t *newp;
+
+    STAT_INC(reallocs);
+    if(need <= order) {
+        STAT_INC(realloc_fast);
+        return bp;
+    }
+
+    // first check that the upper halves are there, then take them
+    for(o = order; o < need && o < REGION_ORDER; o++) {
+        half = (size_t)1 << o;
+        if(off & half)
+            break;
+#if MM_ENGINE == MM_BUDDY
+        if(off + half == buddy_frontier + grow) {
+            grow += half;
+            continue;
+        }
+#endif
+        if(!free_buddy(base, off, o))
+            break;
+    }
+    if(o == need && (!grow || mem_sbrk(grow) != (void *)-1)) {
+        for(o = order; o < need; o++) {
+            half = (size_t)1 << o;
+            if(off + half < REGION_LIMIT)
+                buddy_unlink(free_buddy(base, off, o), o);
+        }
+#if MM_ENGINE == MM_BUDDY
+        if(grow) {
+            STAT_INC(expansions);
+            STAT_ADD(expand_bytes, grow);
+            buddy_frontier += grow;
+        }
+#endif
+        buddy_block(base, off, need, 0);
+        STAT_INC(realloc_fast);
+        return bp;
+    }
+
+    if(!(newp = mm_malloc(size)))
+        return NULL;
+    mem_copy(newp, bp, ((size_t)1 << order) - WSIZE);
+    STAT_ADD(copied_bytes, ((size_t)1 << order) - WSIZE);
+    buddy_release(bp);
+    return newp;
+}
+
+// call f on the blocks of the region at base, up to limit
+static void buddy_walk(char *base, size_t limit, mm_walk_fn f, void *arg) {
+    mm_block_t block;
+    size_t off;
+
+    for(off = 0; off < limit; off += block.size) {
+        block.payload = base + off + WSIZE;
+        block.size = (size_t)1 << BUDDY_ORDER(block.payload);
+        block.overhead = WSIZE;
+        block.free = BUDDY_FREE(block.payload);
+#if MM_ENGINE == MM_HYBRID
+        block.list = block.free ? LIST_COUNT + BUDDY_ORDER(block.payload) : -1;
+#else
+        block.list = block.free ? BUDDY_ORDER(block.payload) : -1;
+#endif
+        f(&block, arg);
+    }
+}
+
+// check the blocks of the region at base, up to limit
+static void buddy_check(char *base, size_t limit) {
+    size_t off, size;
+    size_t *bp;
+    int order;
+
+    for(off = 0; off < limit; off += size) {
+        bp = (size_t *)(base + off + WSIZE);
+        order = BUDDY_ORDER(bp);
+        size = (size_t)1 << order;
+        if(!(GET(HDRP(bp)) & BUDDY_TAG) || order < BUDDY_MIN_ORDER ||
+           order > REGION_ORDER || BUDDY_OFF(bp) != off || (off & (size - 1)))
+            handle_error(NULL, "bad buddy block header");
+        if(off + size > limit)
+            handle_error(NULL, "buddy block past the end of its region");
+        if(BUDDY_FREE(bp) && free_buddy(base, off, order))
+            handle_error(NULL, "buddy coalescing error");
+    }
+}
+
+// check that the free lists hold free blocks of their order
+static void buddy_check_lists(void) {
+    size_t *bp, *pred;
+    int order;
+
+    for(order = 0; order < BUDDY_ORDERS; order++) {
+        pred = NULL;
+        for(bp = buddy_heads[order]; bp; bp = *SUCCP(bp)) {
+            if(!BUDDY_FREE(bp) || BUDDY_ORDER(bp) != order)
+                handle_error(NULL, "allocated or misfiled block in buddy list");
+            if(*PREDP(bp) != pred)
+                handle_error(NULL, "broken buddy list link");
+            pred = bp;
+        }
+    }
+}
+
+// make room for the list heads at the heap start
+static int buddy_init(void) {
+    buddy_heads = mem_sbrk(BUDDY_ORDERS * WSIZE);
+    if(buddy_heads == (void *)-1)
+        return -1;
+    memset(buddy_heads, 0, BUDDY_ORDERS * WSIZE);
+    return 0;
+}
+
+#endif /* MM_ENGINE != MM_SEG */
+
+// bump arenas (mm_arena_*)
+// an arena hands out blocks from chunks it gets with mm_malloc, by
+// bumping a pointer through the newest one: no header, no footer, no
+// free lists. the arena itself sits at the start of its first chunk; the
+// later chunks start with a link to the one before, padded to DSIZE. a
+// request larger than a quarter of a chunk gets a chunk of its own, so
+// that it does not end the newest one early. blocks are not freed one by
+// one: mm_arena_reset gives every chunk but the first back with mm_free,
+// where they coalesce into the free lists, and mm_arena_destroy the
+// first one as well.
+
+#define ARENA_CHUNK (1<<12)     // default payload bytes per chunk
+
+struct mm_arena {
+    char *next;         // bump pointer in the newest chunk
+    char *end;          // end of the newest chunk
+    char *first_end;    // end of the first chunk
+    size_t **chunks;    // the later chunks, newest first
+    size_t chunk_size;  // payload bytes of a new chunk
+};
+
+#define ARENA_HEAD ALIGN(sizeof(struct mm_arena))
+// no heap holds half the address space; larger sizes would wrap around
+// in ALIGN and in the chunk size
+#define ARENA_MAX ((size_t)-1 / 2)
+
+// make an arena whose chunks hold chunk_size bytes (0: ARENA_CHUNK)
+mm_arena_t *mm_arena_create(size_t chunk_size) {
+    mm_arena_t *a;
+
+    if(!chunk_size)
+        chunk_size = ARENA_CHUNK;
+    if(chunk_size > ARENA_MAX)
+        return NULL;
+    chunk_size = ALIGN(chunk_size);
+    if(!(a = mm_malloc(ARENA_HEAD + chunk_size)))
+        return NULL;
+    a->next = (char *)a + ARENA_HEAD;
+    a->end = a->first_end = a->next + chunk_size;
+    a->chunks = NULL;
+    a->chunk_size = chunk_size;
+    return a;
+}
+
+// get a chunk of size bytes for a, returning where its blocks start
+static char *arena_chunk(mm_arena_t *a, size_t size) {
+    size_t **c = mm_malloc(DSIZE + size);
+
+    if(!c)
+        return NULL;
+    *c = (size_t *)a->chunks;
+    a->chunks = c;
+    return (char *)c + DSIZE;
+}
+
+// allocate size bytes from a
+void *mm_arena_alloc(mm_arena_t *a, size_t size) {
+    char *p;
+
+    if(size == 0 || size > ARENA_MAX)
+        return NULL;
+    size = ALIGN(size);
+    if(size <= (size_t)(a->end - a->next)) {
+        p = a->next;
+        a->next += size;
+        return p;
+    }
+    if(size > a->chunk_size / 4)
+        return arena_chunk(a, size);
+    if(!(p = arena_chunk(a, a->chunk_size)))
+        return NULL;
+    a->next = p + size;
+    a->end = p + a->chunk_size;
+    return p;
+}
+
+// free every block of a at once, keeping its first chunk
+void mm_arena_reset(mm_arena_t *a) {
+    size_t **c, **prev;
+
+    for(c = a->chunks; c; c = prev) {
+        prev = (size_t **)*c;
+        mm_free(c);
+    }
+    a->chunks = NULL;
+    a->next = (char *)a + ARENA_HEAD;
+    a->end = a->first_end;
+}
+
+// free every block of a and a itself
+void mm_arena_destroy(mm_arena_t *a) {
+    mm_arena_reset(a);
+    mm_free(a);
+}
+
+// event counters
+
+// copy the event counters to *s (if s is not NULL)
+int mm_stats(mm_stats_t *s) {
+#ifdef MM_STATS
+    if(s) *s = stats;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+// print the event counters
+void mm_print_stats(FILE *fp) {
+    mm_stats_t s;
+
+    if(mm_stats(&s) < 0) {
+        fprintf(fp, "  no counters: build mm.c with -DMM_STATS\n");
+        return;
+    }
+    fprintf(fp, "  find_fit: %ld searches, %ld nodes visited (%.1f per search)\n",
+        s.searches, s.visited, s.searches ? (double)s.visited / s.searches : 0);
+    fprintf(fp, "  splits: %ld, coalesces: %ld prev, %ld next, %ld both\n",
+        s.splits, s.coalesce_prev, s.coalesce_next, s.coalesce_both);
+    fprintf(fp, "  heap expansions: %ld (%ld bytes)\n", s.expansions, s.expand_bytes);
+    fprintf(fp, "  quick lists: %ld hits, %ld consolidations\n",
+        s.quick_hits, s.consolidations);
+    fprintf(fp, "  reallocs: %ld, %ld in place (%.1f%%), %ld into prev, %ld bytes moved, %ld bytes copied\n",
+        s.reallocs, s.realloc_fast,
+        s.reallocs ? 100.0 * s.realloc_fast / s.reallocs : 0,
+        s.realloc_prev, s.moved_bytes, s.copied_bytes);
+}
+
+// the mm.h interface, for the engine chosen by MM_ENGINE
+
+#if MM_ENGINE == MM_SEG
+
+int mm_init(void) {
+#ifdef MM_STATS
+    memset(&stats, 0, sizeof(stats));
+#endif
+    return seg_init();
+}
+
+void *mm_malloc(size_t size) {
+    return seg_malloc(size, 0);
+}
+
+void *mm_malloc_hint(size_t size, int hint) {
+    return seg_malloc(size, hint == MM_HINT_LONG ? LONG_BIT : 0);
+}
+
+void *mm_memalign(size_t align, size_t size) {
+    if(align & (align - 1))
+        return NULL;
+    return seg_memalign(align, size);
+}
+
+void mm_free(void *ptr) {
+    seg_free(ptr);
+}
+
+void mm_free_sized(void *ptr, size_t size) {
+    if(ptr)
+        seg_free_sized(ptr, size);
+}
+
+size_t mm_usable_size(void *ptr) {
+    return ptr ? seg_usable_size(ptr) : 0;
+}
+
+void *mm_realloc(void *ptr, size_t size) {
+    return seg_realloc(ptr, size);
+}
+
+int mm_check(void) {
+    return seg_check();
+}
+
+void mm_walk(mm_walk_fn f, void *arg) {
+    seg_walk(f, arg);
+}
+
+int mm_list_count(void) {
+    return LIST_COUNT + QUICK_LISTS;
+}
+
+#elif MM_ENGINE == MM_BUDDY
+
+int mm_init(void) {
+#ifdef MM_STATS
+    memset(&stats, 0, sizeof(stats));
+#endif
+    if(buddy_init() < 0)
+        return -1;
+    // pad, so that the payload of a block of 2^order bytes is aligned to
+    // 2^order, up to BUDDY_ALIGN
+    char *lo = mem_sbrk(0);
+    size_t pad = (-(size_t)lo - WSIZE) & (BUDDY_ALIGN - 1);
+    if(mem_sbrk(pad) == (void *)-1)
+        return -1;
+    buddy_base = lo + pad;
+    buddy_frontier = 0;
+    return 0;
+}
+
+void *mm_malloc(size_t size) {
+    if(size == 0)
+        return NULL;
+    return buddy_malloc(size);
+}
+
+// one region: the hint is ignored
+void *mm_malloc_hint(size_t size, int hint) {
+    return mm_malloc(size);
+}
+
+// the payload of the block that holds ptr. mm_memalign may return a
+// pointer inside its block, behind a copy of the block header
+#define BUDDY_PAYLOAD(ptr) ((size_t *)(buddy_base + BUDDY_OFF(ptr) + WSIZE))
+
+// alignments up to BUDDY_ALIGN take the size class of the alignment.
+// larger ones get a block with room for the payload at any offset
+void *mm_memalign(size_t align, size_t size) {
+    char *bp, *p;
+
+    if(size == 0 || (align & (align - 1)))
+        return NULL;
+    if(align <= BUDDY_ALIGN)
+        return buddy_malloc(MAX(size, align - WSIZE));
+    if(!(bp = buddy_malloc(size + align - BUDDY_ALIGN)))
+        return NULL;
+    p = bp + (-(size_t)bp & (align - 1));
+    PUT(HDRP(p), GET(HDRP(bp)));
+    return p;
+}
+
+void mm_free(void *ptr) {
+    if(ptr)
+        buddy_release(BUDDY_PAYLOAD(ptr));
+}
+
+size_t mm_usable_size(void *ptr) {
+    if(!ptr)
+        return 0;
+    return ((size_t)1 << BUDDY_ORDER(ptr)) - WSIZE -
+        ((char *)ptr - (char *)BUDDY_PAYLOAD(ptr));
+}
+
+void mm_free_sized(void *ptr, size_t size) {
+    if(!ptr)
+        return;
+#ifdef CHECK_SIZED
+    if(size > mm_usable_size(ptr))
+        handle_error(ptr, "mm_free_sized: size does not match the block");
+#endif
+    buddy_release(BUDDY_PAYLOAD(ptr));
+}
+
+void *mm_realloc(void *ptr, size_t size) {
+    size_t *bp, *newp;
+
+    if(!ptr)
+        return mm_malloc(size);
+    if(!size) {
+        mm_free(ptr);
+        return NULL;
+    }
+    bp = BUDDY_PAYLOAD(ptr);
+    if(bp == ptr)
+        return buddy_realloc(ptr, size);
+
+    // an aligned payload inside its block moves to a block of its own
+    if(!(newp = buddy_malloc(size)))
+        return NULL;
+    mem_copy(newp, ptr, size < mm_usable_size(ptr) ? size : mm_usable_size(ptr));
+    buddy_release(bp);
+    return newp;
+}
+
+int mm_check(void) {
+    buddy_check(buddy_base, buddy_frontier);
+    buddy_check_lists();
+    return 1;
+}
+
+void mm_walk(mm_walk_fn f, void *arg) {
+    buddy_walk(buddy_base, buddy_frontier, f, arg);
+}
+
+int mm_list_count(void) {
+    return BUDDY_ORDERS;
+}
+
+#else /* MM_HYBRID */
+
+// does a request of size bytes go to the buddy arenas?
+#define IS_SMALL(size) ((size) + WSIZE <= ((size_t)1 << HYBRID_MAX_ORDER))
+
+int mm_init(void) {
+#ifdef MM_STATS
+    memset(&stats, 0, sizeof(stats));
+#endif
+    // the list heads keep the seg-list heap aligned
+    if(buddy_init() < 0)
+        return -1;
+    return seg_init();
+}
+
+void *mm_malloc(size_t size) {
+    if(size == 0)
+        return NULL;
+    if(IS_SMALL(size))
+        return buddy_malloc(size);
+    return seg_malloc(size, 0);
+}
+
+// the buddy arenas ignore the hint
+void *mm_malloc_hint(size_t size, int hint) {
+    if(size == 0)
+        return NULL;
+    if(IS_SMALL(size))
+        return buddy_malloc(size);
+    return seg_malloc(size, hint == MM_HINT_LONG ? LONG_BIT : 0);
+}
+
+// the buddy arenas only give DSIZE alignment
+void *mm_memalign(size_t align, size_t size) {
+    if(align & (align - 1))
+        return NULL;
+    if(align <= DSIZE)
+        return mm_malloc(size);
+    return seg_memalign(align, size);
+}
+
+void mm_free(void *ptr) {
+    if(!ptr)
+        return;
+    if(GET(HDRP(ptr)) & BUDDY_TAG)
+        buddy_release(ptr);
+    else
+        seg_free(ptr);
+}
+
+// the header still tells buddy blocks from seg-list blocks: realloc
+// leaves a small block in the seg-lists when it shrinks one in place
+void mm_free_sized(void *ptr, size_t size) {
+    if(!ptr)
+        return;
+    if(!(GET(HDRP(ptr)) & BUDDY_TAG)) {
+        seg_free_sized(ptr, size);
+        return;
+    }
+#ifdef CHECK_SIZED
+    if(size + WSIZE > ((size_t)1 << BUDDY_ORDER(ptr)))
+        handle_error(ptr, "mm_free_sized: size does not match the block");
+#endif
+    buddy_release(ptr);
+}
+
+size_t mm_usable_size(void *ptr) {
+    if(!ptr)
+        return 0;
+    if(GET(HDRP(ptr)) & BUDDY_TAG)
+        return ((size_t)1 << BUDDY_ORDER(ptr)) - WSIZE;
+    return seg_usable_size(ptr);
+}
+
+void *mm_realloc(void *ptr, size_t size) {
+    size_t *newp;
+
+    if(!ptr)
+        return mm_malloc(size);
+    if(!size) {
+        mm_free(ptr);
+        return NULL;
+    }
+    if(!(GET(HDRP(ptr)) & BUDDY_TAG))
+        return seg_realloc(ptr, size);
+    if(IS_SMALL(size))
+        return buddy_realloc(ptr, size);
+
+    // outgrows the buddy arenas
+    if(!(newp = seg_malloc(size, 0)))
+        return NULL;
+    mem_copy(newp, ptr, ((size_t)1 << BUDDY_ORDER(ptr)) - WSIZE);
+    buddy_release(ptr);
+    return newp;
+}
+
+int mm_check(void) {
+    seg_check();
+    buddy_check_lists();
+    return 1;
+}
+
+void mm_walk(mm_walk_fn f, void *arg) {
+    seg_walk(f, arg);
+}
+
+int mm_list_count(void) {
+    return LIST_COUNT + BUDDY_ORDERS + QUICK_LISTS;
+}
+
+#endif
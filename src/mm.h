@@ -1,6 +1,75 @@
+#ifndef __MM_H_
+#define __MM_H_
+
 #include <stdio.h>
 
 extern int mm_init (void);
 extern void *mm_malloc (size_t size);
 extern void mm_free (void *ptr);
 extern void *mm_realloc(void *ptr, size_t size);
+
+/* free of a block whose payload size (as last requested) is known; the
+   size is checked against the block when built with CHECK_SIZED */
+extern void mm_free_sized(void *ptr, size_t size);
+/* bytes usable in the payload of ptr, at least the requested size */
+extern size_t mm_usable_size(void *ptr);
+
+/* malloc with the payload aligned to align, a power of two */
+extern void *mm_memalign(size_t align, size_t size);
+
+/* malloc with a lifetime hint: blocks of each lifetime are placed apart */
+#define MM_HINT_SHORT 0     /* request-scoped, like mm_malloc */
+#define MM_HINT_LONG  1     /* long-lived */
+extern void *mm_malloc_hint(size_t size, int hint);
+
+/* bump arenas: blocks allocated by bumping a pointer through chunks
+   from mm_malloc, and freed all at once by reset or destroy */
+typedef struct mm_arena mm_arena_t;
+extern mm_arena_t *mm_arena_create(size_t chunk_size);  /* 0: default */
+extern void *mm_arena_alloc(mm_arena_t *arena, size_t size);
+extern void mm_arena_reset(mm_arena_t *arena);
+extern void mm_arena_destroy(mm_arena_t *arena);
+
+/* heap consistency checker; reports the first problem and exits */
+extern int mm_check(void);
+
+/* heap introspection, for the driver's analysis tools */
+
+typedef struct {
+    void *payload;      /* payload address */
+    size_t size;        /* block size, including overhead */
+    size_t overhead;    /* bytes used by the allocator (header, footer) */
+    int free;           /* is the block free? */
+    int list;           /* free list holding the block, -1 if allocated */
+} mm_block_t;
+
+typedef void (*mm_walk_fn)(mm_block_t *block, void *arg);
+
+extern void mm_walk(mm_walk_fn f, void *arg);
+extern int mm_list_count(void);
+
+/* allocator event counters, kept only when mm.c is built with -DMM_STATS */
+
+typedef struct {
+    long searches;      /* find_fit calls */
+    long visited;       /* free list nodes visited by those searches */
+    long splits;        /* free blocks split in two */
+    long coalesce_prev; /* frees merged with the previous block only */
+    long coalesce_next; /* frees merged with the next block only */
+    long coalesce_both; /* frees merged with both neighbours */
+    long expansions;    /* heap expansions */
+    long expand_bytes;  /* bytes added by them */
+    long quick_hits;    /* mallocs served from a quick list */
+    long consolidations; /* quick list flushes into the free lists */
+    long reallocs;      /* reallocs of a block to a nonzero size */
+    long realloc_fast;  /* ... done in place, without malloc and copy */
+    long realloc_prev;  /* ... of them by merging the previous block */
+    long moved_bytes;   /* payload bytes moved by memmove in realloc */
+    long copied_bytes;  /* payload bytes copied by the malloc fallback */
+} mm_stats_t;
+
+/* counters since the last mm_init; -1 if they are not compiled in */
+extern int mm_stats(mm_stats_t *stats);
+extern void mm_print_stats(FILE *fp);
+
+#endif /* __MM_H_ */
@@ -0,0 +1,24 @@
+/*
+ * mm_plugin.c - exports the mm package in mm.c as an mdriver plugin
+ *
+ * Build mm.c together with this file into a shared object (make mm.so)
+ * and load it with "mdriver -L ./mm.so".
+ */
+#include "mm_plugin.h"
+
+mm_plugin_t mm_plugin = {
+    MM_PLUGIN_VERSION,
+    "mm",
+    NULL,
+    mm_malloc,
+    mm_free,
+    mm_realloc,
+    mm_init,
+    mm_print_stats,
+    mm_walk,
+    mm_list_count,
+    mm_malloc_hint,
+    mm_memalign,
+    mm_free_sized,
+    mm_usable_size
+};
@@ -0,0 +1,47 @@
+/*
+ * mm_plugin.h - allocator plugin interface
+ *
+ * mdriver evaluates its built-in mm package and, with -L <path>, any
+ * number of allocators loaded as shared objects. A plugin exports one
+ * object named MM_PLUGIN_SYMBOL of type mm_plugin_t. Plugins that model
+ * their heap with memlib.c (mem_sbrk and friends) get those functions
+ * from mdriver, which resets the simulated brk before every replay.
+ */
+#ifndef __MM_PLUGIN_H_
+#define __MM_PLUGIN_H_
+
+#include <stdio.h>
+#include "mm.h"
+
+#define MM_PLUGIN_SYMBOL  "mm_plugin"
+#define MM_PLUGIN_VERSION 4  /* older plugins end before malloc_hint (1),
+                                memalign (2), free_sized (3) */
+
+typedef struct {
+    int version;                        /* 1..MM_PLUGIN_VERSION; later fields are
+                                           ignored for older versions */
+    const char *name;                   /* short name used in tables */
+
+    int (*init)(void);                  /* called once after loading (may be NULL) */
+    void *(*malloc)(size_t size);
+    void (*free)(void *ptr);
+    void *(*realloc)(void *ptr, size_t size);
+    int (*reset)(void);                 /* start over with an empty heap; <0 on error */
+    void (*stats)(FILE *fp);            /* print allocator statistics (may be NULL) */
+
+    /* optional heap introspection, as in mm.h (may be NULL) */
+    void (*walk)(mm_walk_fn f, void *arg);
+    int (*list_count)(void);
+
+    /* optional malloc with a lifetime hint, as in mm.h (may be NULL) */
+    void *(*malloc_hint)(size_t size, int hint);
+
+    /* optional aligned malloc, as in mm.h (may be NULL) */
+    void *(*memalign)(size_t align, size_t size);
+
+    /* optional sized free and usable size, as in mm.h (may be NULL) */
+    void (*free_sized)(void *ptr, size_t size);
+    size_t (*usable_size)(void *ptr);
+} mm_plugin_t;
+
+#endif /* __MM_PLUGIN_H_ */
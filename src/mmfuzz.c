@@ -0,0 +1,666 @@
+/*
+ * mmfuzz.c - coverage-guided fuzzing of the mm malloc package
+ *
+ * An input is a sequence of 4-byte requests:
+ *     byte 0: request (bits 0-1: 0 = malloc, 1 = mm_free_sized, 2 = realloc,
+ *             3 = mm_malloc_hint(MM_HINT_LONG)) and size magnitude
+ *             (bits 2-7, taken % MAXMAG)
+ *     byte 1: slot (byte % NSLOTS) holding the block; a malloc with
+ *             bits 6-7 set is an mm_memalign to 32, 512 or 4096 bytes,
+ *             and a free with bits 6-7 set is an arena request on arena
+ *             slot % NARENAS: 1 = mm_arena_alloc (mm_arena_create with
+ *             chunk size size first, if the arena is not there), 2 =
+ *             mm_arena_reset, 3 = mm_arena_destroy
+ *     byte 2,3: size bits; size = 1 + bits % (2 << magnitude)
+ * so small requests are frequent but sizes up to 16K are reachable.
+ * free and realloc of an empty slot are a realloc(NULL) or no-op, so
+ * every input is a valid request sequence. Every payload is filled with
+ * its slot number, every arena block with NSLOTS + its arena number.
+ * After each request the range list (add_range) checks alignment, heap
+ * bounds and overlaps, the payloads are checked for damage, and
+ * mm_check() checks the heap itself. The arena blocks are checked for
+ * damage when their arena is reset or destroyed. Any failure aborts, so
+ * the fuzzer keeps the input.
+ *
+ * Two builds, see the Makefile:
+ *   mmfuzz     clang with libFuzzer (-DMMFUZZ_LIBFUZZER), the usual
+ *              libFuzzer command line, e.g. "mmfuzz fuzz/corpus"
+ *   mmfuzz-gcc gcc only. mm.c is compiled with -fsanitize-coverage=trace-pc
+ *              and a small built-in mutation loop keeps the inputs that
+ *              reach new edges of mm.c.
+ * Both run with ASan and UBSan and need no network. The seed corpus is
+ * made from the trace files with "mmfuzz-gcc -S <dir> <trace>...".
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef __SANITIZE_ADDRESS__
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+#include "mm.h"
+#include "memlib.h"
+#include "range.h"
+
+#define NSLOTS        64   /* blocks live at the same time */
+#define MAXMAG        14   /* sizes up to 2 << (MAXMAG-1) bytes */
+#define REQSIZE        4   /* bytes per request */
+#define MAXINPUT    4096   /* max input length (1024 requests) */
+#define NARENAS        4   /* arenas live at the same time */
+#define ARENA_BLOCKS 256   /* arena blocks checked per arena */
+
+static const int aligns[4] = {0, 32, 512, 4096}; /* by byte 1 bits 6-7 */
+
+static char *slot_ptr[NSLOTS];   /* payload of each slot, or NULL */
+static int slot_size[NSLOTS];    /* payload size of each slot */
+static range_t *ranges = NULL;   /* the payloads, for add_range */
+
+static mm_arena_t *arena[NARENAS];                /* each arena, or NULL */
+static char *arena_ptr[NARENAS][ARENA_BLOCKS];    /* its blocks... */
+static int arena_size[NARENAS][ARENA_BLOCKS];     /* ...their sizes */
+static int arena_count[NARENAS];                  /* ...and how many */
+
+/*
+ * fail - end the run on an allocator error, keeping the message
+ */
+static void fail(void)
+{
+    fflush(stdout);
+    abort();
+}
+
+/*
+ * malloc_error - Report a bad payload found by add_range and abort
+ */
+void malloc_error(int tracenum, int opnum, char *msg)
+{
+    printf("ERROR [request %d]: %s\n", opnum, msg);
+    fail();
+}
+
+/*
+ * damaged - offset of the first of size bytes at p that is not fill,
+ *     or -1 if they all are
+ */
+static int damaged(const char *p, int fill, int size)
+{
+    static char ref[2 << (MAXMAG-1)];
+    int i;
+
+    memset(ref, fill, size);
+    if (memcmp(p, ref, size) == 0)
+	return -1;
+    for (i = 0; p[i] == (char)fill; i++)
+	;
+    return i;
+}
+
+/*
+ * check_payload - make sure the first size bytes of a payload still hold
+ *     the slot's fill byte
+ */
+static void check_payload(int slot, int size, int opnum)
+{
+    int i = damaged(slot_ptr[slot], slot, size);
+
+    if (i < 0)
+	return;
+    printf("ERROR [request %d]: payload of slot %d damaged at byte %d\n",
+	   opnum, slot, i);
+    fail();
+}
+
+/*
+ * release_arena - check the blocks of arena a for damage and drop them
+ *     from the range list, before the arena is reset or destroyed
+ */
+static void release_arena(int a, int opnum)
+{
+    int k, i;
+
+    for (k = 0; k < arena_count[a]; k++) {
+	if ((i = damaged(arena_ptr[a][k], NSLOTS + a, arena_size[a][k])) >= 0) {
+	    printf("ERROR [request %d]: block %d of arena %d damaged at byte %d\n",
+		   opnum, k, a, i);
+	    fail();
+	}
+	remove_range(&ranges, arena_ptr[a][k]);
+    }
+    arena_count[a] = 0;
+}
+
+/*
+ * arena_request - allocate size bytes from arena a (req 1), making the
+ *     arena first if needed, reset it (2) or destroy it (3)
+ */
+static void arena_request(int req, int a, int size, int opnum)
+{
+    char *p;
+
+    if (req == 1) {
+	if (!arena[a] && (arena[a] = mm_arena_create(size)) == NULL) {
+	    printf("ERROR [request %d]: mm_arena_create(%d) failed\n",
+		   opnum, size);
+	    fail();
+	}
+	if ((p = mm_arena_alloc(arena[a], size)) == NULL) {
+	    printf("ERROR [request %d]: mm_arena_alloc(%d) failed\n",
+		   opnum, size);
+	    fail();
+	}
+	if (arena_count[a] < ARENA_BLOCKS) {
+	    add_range(&ranges, p, size, 0, opnum);
+	    memset(p, NSLOTS + a, size);
+	    arena_ptr[a][arena_count[a]] = p;
+	    arena_size[a][arena_count[a]++] = size;
+	}
+	return;
+    }
+    if (!arena[a])
+	return;
+    release_arena(a, opnum);
+    if (req == 2)
+	mm_arena_reset(arena[a]);
+    else {
+	mm_arena_destroy(arena[a]);
+	arena[a] = NULL;
+    }
+}
+
+/*
+ * new_payload - check a block just returned by mm_malloc/mm_realloc
+ *     and fill it
+ */
+static void new_payload(int slot, char *p, int size, int opnum)
+{
+    if (p == NULL) {
+	printf("ERROR [request %d]: mm_malloc/mm_realloc(%d) failed\n",
+	       opnum, size);
+	fail();
+    }
+    add_range(&ranges, p, size, 0, opnum);
+    slot_ptr[slot] = p;
+    slot_size[slot] = size;
+    /* the slack that mm_usable_size reports must be writable, too */
+    memset(p, slot, mm_usable_size(p));
+}
+
+/*
+ * run_input - replay one input on a fresh heap
+ */
+static void run_input(const uint8_t *data, size_t len)
+{
+    static int initialized = 0;
+    int i, slot, size, mag, align;
+    char *p;
+
+    if (!initialized) {
+	mem_init();
+	initialized = 1;
+    }
+    mem_reset_brk();
+    clear_ranges(&ranges);
+    memset(slot_ptr, 0, sizeof(slot_ptr));
+    memset(arena, 0, sizeof(arena));
+    memset(arena_count, 0, sizeof(arena_count));
+    if (mm_init() < 0) {
+	printf("ERROR: mm_init failed\n");
+	fail();
+    }
+
+    if (len > MAXINPUT)
+	len = MAXINPUT;
+    for (i = 0; (i + 1) * REQSIZE <= len; i++) {
+	const uint8_t *req = data + i * REQSIZE;
+
+	slot = req[1] % NSLOTS;
+	mag = (req[0] >> 2) % MAXMAG;
+	size = 1 + (req[2] | (req[3] << 8)) % (2 << mag);
+
+	switch (req[0] & 3) {
+	case 0:
+	case 3: /* malloc, freeing the slot's old block first */
+	    if (slot_ptr[slot]) {
+		check_payload(slot, slot_size[slot], i);
+		remove_range(&ranges, slot_ptr[slot]);
+		mm_free(slot_ptr[slot]);
+	    }
+	    align = (req[0] & 3) ? 0 : aligns[req[1] >> 6];
+	    if (align)
+		p = mm_memalign(align, size);
+	    else
+		p = (req[0] & 3) ? mm_malloc_hint(size, MM_HINT_LONG) :
+		    mm_malloc(size);
+	    if (align && p && (size_t)p % align != 0) {
+		printf("ERROR [request %d]: mm_memalign(%d, %d) returned %p\n",
+		       i, align, size, p);
+		fail();
+	    }
+	    new_payload(slot, p, size, i);
+	    break;
+
+	case 1: /* free, or an arena request */
+	    if (req[1] >> 6) {
+		arena_request(req[1] >> 6, slot % NARENAS, size, i);
+		break;
+	    }
+	    if (!slot_ptr[slot])
+		break;
+	    check_payload(slot, slot_size[slot], i);
+	    remove_range(&ranges, slot_ptr[slot]);
+	    mm_free_sized(slot_ptr[slot], slot_size[slot]);
+	    slot_ptr[slot] = NULL;
+	    break;
+
+	case 2: /* realloc; the old data must be preserved */
+	    if (slot_ptr[slot]) {
+		check_payload(slot, slot_size[slot], i);
+		remove_range(&ranges, slot_ptr[slot]);
+	    }
+	    p = mm_realloc(slot_ptr[slot], size);
+	    if (slot_ptr[slot] && p) {
+		slot_ptr[slot] = p;
+		check_payload(slot, size < slot_size[slot] ?
+			      size : slot_size[slot], i);
+	    }
+	    new_payload(slot, p, size, i);
+	    break;
+	}
+	mm_check();
+    }
+
+    /* free everything, which exercises coalescing */
+    for (slot = 0; slot < NSLOTS; slot++) {
+	if (!slot_ptr[slot])
+	    continue;
+	check_payload(slot, slot_size[slot], i);
+	mm_free(slot_ptr[slot]);
+	slot_ptr[slot] = NULL;
+    }
+    for (slot = 0; slot < NARENAS; slot++)
+	arena_request(3, slot, 0, i);
+    mm_check();
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t len)
+{
+    run_input(data, len);
+    return 0;
+}
+
+#ifndef MMFUZZ_LIBFUZZER
+
+/*********************************************************************
+ * The standalone fuzzer: seed corpus writer, input replay, and a
+ * mutation loop guided by the trace-pc edge coverage of mm.c
+ ********************************************************************/
+
+#define COVSIZE    65536   /* edge coverage map entries */
+#define MAXCORPUS  10000   /* max inputs kept in memory */
+
+static uint8_t cov[COVSIZE];     /* edges hit by the current input */
+static uint8_t seen[COVSIZE];    /* edges hit by any input so far */
+static int edges = 0;            /* number of edges in seen */
+static uintptr_t prev_pc;
+
+static uint8_t *corpus[MAXCORPUS];  /* the inputs... */
+static size_t corpus_len[MAXCORPUS]; /* ...and their lengths */
+static int corpus_n = 0;
+
+static uint8_t cur[MAXINPUT];   /* the input being run */
+static size_t cur_len;
+static volatile int running = 0;
+static unsigned long long rng = 0x9e3779b97f4a7c15ULL;
+
+/*
+ * __sanitizer_cov_trace_pc - called by gcc on every basic block of the
+ *     code compiled with -fsanitize-coverage=trace-pc (here: mm.c).
+ *     Records the edge from the previous block, as AFL does.
+ */
+void __sanitizer_cov_trace_pc(void)
+{
+    uintptr_t pc = (uintptr_t)__builtin_return_address(0);
+
+    cov[(pc ^ (prev_pc >> 1)) % COVSIZE] = 1;
+    prev_pc = pc;
+}
+
+/*
+ * random_int - xorshift64* random number in [0, n)
+ */
+static unsigned random_int(unsigned n)
+{
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return (unsigned)((rng * 2685821657736338717ULL) >> 33) % n;
+}
+
+/*
+ * write_input - write an input to dir/name
+ */
+static void write_input(char *dir, char *name, const uint8_t *data,
+			size_t len)
+{
+    char path[1024];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if ((fp = fopen(path, "wb")) == NULL) {
+	perror(path);
+	exit(1);
+    }
+    fwrite(data, 1, len, fp);
+    fclose(fp);
+}
+
+/*
+ * save_crash - keep the input that is running when the process dies
+ */
+static void save_crash(void)
+{
+    char name[64];
+
+    if (!running)
+	return;
+    running = 0;
+    sprintf(name, "crash-%016llx", rng);
+    write_input(".", name, cur, cur_len);
+    fprintf(stderr, "mmfuzz: failing input written to %s\n", name);
+}
+
+static void crash_handler(int sig)
+{
+    save_crash();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/*
+ * run_cur - run cur; returns 1 if it hit an edge no input hit before
+ */
+static int run_cur(void)
+{
+    int i, new = 0;
+
+    memset(cov, 0, sizeof(cov));
+    prev_pc = 0;
+    running = 1;
+    run_input(cur, cur_len);
+    running = 0;
+    for (i = 0; i < COVSIZE; i++)
+	if (cov[i] && !seen[i]) {
+	    seen[i] = 1;
+	    edges++;
+	    new = 1;
+	}
+    return new;
+}
+
+/*
+ * add_corpus - keep a copy of cur in the in-memory corpus
+ */
+static void add_corpus(void)
+{
+    if (corpus_n == MAXCORPUS)
+	return;
+    if ((corpus[corpus_n] = malloc(cur_len + 1)) == NULL) {
+	fprintf(stderr, "mmfuzz: out of memory\n");
+	exit(1);
+    }
+    memcpy(corpus[corpus_n], cur, cur_len);
+    corpus_len[corpus_n++] = cur_len;
+}
+
+/*
+ * load_file - read a file into cur
+ */
+static int load_file(char *path)
+{
+    FILE *fp;
+
+    if ((fp = fopen(path, "rb")) == NULL)
+	return 0;
+    cur_len = fread(cur, 1, MAXINPUT, fp);
+    fclose(fp);
+    return 1;
+}
+
+/*
+ * mutate - replace cur with a mutated corpus input
+ */
+static void mutate(void)
+{
+    int k, n, i, at;
+    uint8_t *other;
+
+    k = random_int(corpus_n);
+    memcpy(cur, corpus[k], corpus_len[k]);
+    cur_len = corpus_len[k];
+
+    n = 1 + random_int(4);
+    while (n--) {
+	switch (random_int(5)) {
+	case 0: /* flip a bit */
+	    if (cur_len)
+		cur[random_int(cur_len)] ^= 1 << random_int(8);
+	    break;
+	case 1: /* set a byte */
+	    if (cur_len)
+		cur[random_int(cur_len)] = random_int(256);
+	    break;
+	case 2: /* insert a random request */
+	    if (cur_len + REQSIZE > MAXINPUT)
+		break;
+	    at = random_int(cur_len / REQSIZE + 1) * REQSIZE;
+	    memmove(cur + at + REQSIZE, cur + at, cur_len - at);
+	    for (i = 0; i < REQSIZE; i++)
+		cur[at + i] = random_int(256);
+	    cur_len += REQSIZE;
+	    break;
+	case 3: /* delete a request */
+	    if (cur_len < REQSIZE)
+		break;
+	    at = random_int(cur_len / REQSIZE) * REQSIZE;
+	    memmove(cur + at, cur + at + REQSIZE, cur_len - at - REQSIZE);
+	    cur_len -= REQSIZE;
+	    break;
+	case 4: /* splice in the tail of another input */
+	    k = random_int(corpus_n);
+	    other = corpus[k];
+	    at = random_int(cur_len / REQSIZE + 1) * REQSIZE;
+	    i = random_int(corpus_len[k] / REQSIZE + 1) * REQSIZE;
+	    cur_len = at + (corpus_len[k] - i);
+	    if (cur_len > MAXINPUT)
+		cur_len = MAXINPUT;
+	    memcpy(cur + at, other + i, cur_len - at);
+	    break;
+	}
+    }
+}
+
+/*
+ * seed_corpus - turn trace files into inputs in dir. Trace ids map to
+ *     slots, and every trace is cut into pieces of MAXINPUT bytes.
+ */
+static void seed_corpus(char *dir, int n, char **traces)
+{
+    FILE *fp;
+    char type[16], name[1024], *base;
+    int t, id, align, size, mag, piece, ch, hint, hdr[4];
+
+    mkdir(dir, 0755);
+    for (t = 0; t < n; t++) {
+	if ((fp = fopen(traces[t], "r")) == NULL) {
+	    perror(traces[t]);
+	    exit(1);
+	}
+	if (fscanf(fp, "%d %d %d %d", &hdr[0], &hdr[1], &hdr[2], &hdr[3]) != 4) {
+	    fprintf(stderr, "mmfuzz: bad trace header in %s\n", traces[t]);
+	    exit(1);
+	}
+	base = strrchr(traces[t], '/') ? strrchr(traces[t], '/') + 1 : traces[t];
+	cur_len = 0;
+	piece = 0;
+	while (fscanf(fp, "%15s", type) == 1) {
+	    size = 1;
+	    align = 0;
+	    if (type[0] == 'f') {
+		if (fscanf(fp, "%d", &id) != 1)
+		    break;
+	    }
+	    else if (type[0] == 'm') {
+		if (fscanf(fp, "%d %d %d", &id, &align, &size) != 3)
+		    break;
+	    }
+	    else if (fscanf(fp, "%d %d", &id, &size) != 2)
+		break;
+	    /* skip any optional columns, but keep a long-lived hint */
+	    hint = 0;
+	    while ((ch = fgetc(fp)) != EOF && ch != '\n')
+		if (ch == 'h')
+		    hint = (fgetc(fp) == '1');
+	    size = size < 1 ? 1 : (size > (2 << (MAXMAG-1)) ?
+				   (2 << (MAXMAG-1)) : size);
+	    for (mag = 0; (2 << mag) < size; mag++)
+		;
+	    cur[cur_len++] = (type[0] == 'a' ? (hint ? 3 : 0) :
+			      type[0] == 'm' ? 0 : type[0] == 'f' ? 1 : 2) + 4 * mag;
+	    /* an alignment maps to the largest fuzzer one it holds */
+	    cur[cur_len++] = id % NSLOTS + 64 * (align >= 4096 ? 3 :
+			      align >= 512 ? 2 : align >= 32);
+	    cur[cur_len++] = (size - 1) & 0xff;
+	    cur[cur_len++] = (size - 1) >> 8;
+	    if (cur_len == MAXINPUT) {
+		sprintf(name, "%s.%d", base, piece++);
+		write_input(dir, name, cur, cur_len);
+		cur_len = 0;
+	    }
+	}
+	if (cur_len) {
+	    sprintf(name, "%s.%d", base, piece++);
+	    write_input(dir, name, cur, cur_len);
+	}
+	fclose(fp);
+	printf("%s: %d inputs\n", traces[t], piece);
+    }
+}
+
+/*
+ * usage - explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mmfuzz-gcc [-h] [-n <runs>] [-r <seed>] <corpus dir>\n"
+	    "       mmfuzz-gcc -S <corpus dir> <trace>...\n"
+	    "       mmfuzz-gcc -x <input>...\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h            Print this message.\n");
+    fprintf(stderr, "\t-n <runs>     Stop after <runs> inputs (default: never).\n");
+    fprintf(stderr, "\t-r <seed>     Random seed.\n");
+    fprintf(stderr, "\t-S <dir>      Write a seed corpus made from the traces to <dir>.\n");
+    fprintf(stderr, "\t-x            Run the given inputs once, e.g. a crash file.\n");
+}
+
+int main(int argc, char **argv)
+{
+    char *seed_dir = NULL, *dir, path[1024], name[64];
+    long long runs = -1, n;
+    int c, replay = 0, newcov;
+    DIR *d;
+    struct dirent *e;
+
+    while ((c = getopt(argc, argv, "hn:r:S:x")) != EOF) {
+	switch (c) {
+	case 'n':
+	    runs = atoll(optarg);
+	    break;
+	case 'r':
+	    rng = strtoull(optarg, NULL, 0) | 1;
+	    break;
+	case 'S':
+	    seed_dir = optarg;
+	    break;
+	case 'x':
+	    replay = 1;
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+
+    if (seed_dir) {
+	seed_corpus(seed_dir, argc - optind, argv + optind);
+	exit(0);
+    }
+    if (replay) {
+	for (; optind < argc; optind++) {
+	    if (!load_file(argv[optind])) {
+		perror(argv[optind]);
+		exit(1);
+	    }
+	    run_input(cur, cur_len);
+	    printf("%s: ok\n", argv[optind]);
+	}
+	exit(0);
+    }
+    if (argc - optind != 1) {
+	usage();
+	exit(1);
+    }
+    dir = argv[optind];
+
+    atexit(save_crash);  /* mm_check exits on a broken heap */
+#ifdef __SANITIZE_ADDRESS__
+    __sanitizer_set_death_callback(save_crash);
+#endif
+    signal(SIGSEGV, crash_handler);
+    signal(SIGBUS, crash_handler);
+    signal(SIGABRT, crash_handler);
+    signal(SIGFPE, crash_handler);
+
+    /* run the corpus, then keep every mutant that finds a new edge */
+    if ((d = opendir(dir)) == NULL) {
+	perror(dir);
+	exit(1);
+    }
+    while ((e = readdir(d)) != NULL) {
+	if (e->d_name[0] == '.')
+	    continue;
+	snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+	if (!load_file(path))
+	    continue;
+	run_cur();
+	add_corpus();
+    }
+    closedir(d);
+    if (corpus_n == 0) {
+	cur_len = 0;
+	add_corpus();
+    }
+    printf("%d corpus inputs loaded, %d edges\n", corpus_n, edges);
+
+    for (n = 0; runs < 0 || n < runs; n++) {
+	mutate();
+	newcov = run_cur();
+	if (newcov) {
+	    add_corpus();
+	    sprintf(name, "cov-%016llx", rng);
+	    write_input(dir, name, cur, cur_len);
+	}
+	if (newcov || (n & 0xffff) == 0)
+	    printf("run %lld: %d inputs, %d edges\n", n, corpus_n, edges);
+    }
+    return 0;
+}
+
+#endif /* MMFUZZ_LIBFUZZER */
@@ -0,0 +1,140 @@
+/*
+ * perfctr.c - hardware performance counters based on perf_event_open(2)
+ *
+ * Counters are per-thread, user space only, and read with the
+ * enabled/running times so that multiplexed events are scaled up to
+ * the full measurement interval.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perfctr.h"
+
+/* cache event config: (cache id) | (op << 8) | (result << 16) */
+#define CACHE_EVENT(id, op, res) \
+    ((id) | ((PERF_COUNT_HW_CACHE_OP_ ## op) << 8) | \
+     ((PERF_COUNT_HW_CACHE_RESULT_ ## res) << 16))
+
+static const struct {
+    char *name;
+    unsigned type;
+    unsigned long long config;
+} events[PC_NEVENTS] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instrs", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"L1d-miss", PERF_TYPE_HW_CACHE,
+     CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, READ, MISS)},
+    {"LLC-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"dTLB-miss", PERF_TYPE_HW_CACHE,
+     CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, READ, MISS)},
+    {"br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+static int fds[PC_NEVENTS];  /* one fd per event, -1 if unavailable */
+static int nopen = 0;        /* number of events opened */
+
+/*
+ * open_event - open a single disabled, user-only counter for this thread
+ */
+static int open_event(unsigned type, unsigned long long config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+	PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ * perfctr_init - open every event we can; return how many succeeded
+ */
+int perfctr_init(void)
+{
+    int i;
+
+    nopen = 0;
+    for (i = 0; i < PC_NEVENTS; i++) {
+	fds[i] = open_event(events[i].type, events[i].config);
+	if (fds[i] >= 0)
+	    nopen++;
+    }
+    return nopen;
+}
+
+/*
+ * perfctr_deinit - close all open counters
+ */
+void perfctr_deinit(void)
+{
+    int i;
+
+    for (i = 0; i < PC_NEVENTS; i++) {
+	if (nopen && fds[i] >= 0)
+	    close(fds[i]);
+	fds[i] = -1;
+    }
+    nopen = 0;
+}
+
+/*
+ * perfctr_start - zero and enable the counters
+ */
+void perfctr_start(void)
+{
+    int i;
+
+    if (!nopen)
+	return;
+    for (i = 0; i < PC_NEVENTS; i++) {
+	if (fds[i] >= 0) {
+	    ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+	    ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+    }
+}
+
+/*
+ * perfctr_stop - disable the counters and read them into *pc
+ */
+void perfctr_stop(perfctr_t *pc)
+{
+    unsigned long long val[3]; /* value, time enabled, time running */
+    int i;
+
+    memset(pc, 0, sizeof(*pc));
+    if (!nopen)
+	return;
+    for (i = 0; i < PC_NEVENTS; i++)
+	if (fds[i] >= 0)
+	    ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+    for (i = 0; i < PC_NEVENTS; i++) {
+	if (fds[i] < 0)
+	    continue;
+	if (read(fds[i], val, sizeof(val)) != sizeof(val) || val[2] == 0)
+	    continue;
+	/* scale up if the event was multiplexed with others */
+	pc->count[i] = (double)val[0] * ((double)val[1] / (double)val[2]);
+	pc->valid[i] = 1;
+    }
+}
+
+/*
+ * perfctr_name - short name of event i, for table headers
+ */
+const char *perfctr_name(int i)
+{
+    return events[i].name;
+}
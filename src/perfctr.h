@@ -0,0 +1,39 @@
+/*
+ * perfctr.h - hardware performance counters (Linux perf_event_open)
+ *
+ * The counters are opened once with perfctr_init() and then
+ * enabled/disabled around each measured region. Every event is opened
+ * on its own, so a machine that lacks e.g. dTLB events still reports
+ * the rest. If no event can be opened at all, perfctr_init() returns 0
+ * and perfctr_start()/perfctr_stop() become no-ops.
+ */
+
+/* The events we collect, in report order */
+#define PC_CYCLES     0  /* cpu cycles */
+#define PC_INSTRS     1  /* retired instructions */
+#define PC_L1D_MISS   2  /* L1 data cache read misses */
+#define PC_LLC_MISS   3  /* last level cache misses */
+#define PC_DTLB_MISS  4  /* data TLB read misses */
+#define PC_BR_MISS    5  /* mispredicted branches */
+#define PC_NEVENTS    6
+
+/* Counter values for one measured region */
+typedef struct {
+    double count[PC_NEVENTS];  /* scaled event counts */
+    int valid[PC_NEVENTS];     /* was the event counted? */
+} perfctr_t;
+
+/* Open the counters; returns the number of usable events (0 = disabled) */
+int perfctr_init(void);
+
+/* Close the counters */
+void perfctr_deinit(void);
+
+/* Reset and enable the counters */
+void perfctr_start(void);
+
+/* Disable the counters and store their values in *pc */
+void perfctr_stop(perfctr_t *pc);
+
+/* Short column name of event i */
+const char *perfctr_name(int i);
@@ -0,0 +1,116 @@
+/*
+ * range.c - The range list, which keeps track of the extent of every
+ *     allocated block payload. We use the range list to detect any 
+ *     misaligned, out of heap or overlapping allocated blocks.
+ *
+ * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
+ * May not be used, modified, or copied without permission.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "memlib.h"
+#include "config.h"
+#include "range.h"
+
+#define MAXLINE     1024 /* max string size */
+
+/* Returns true if p is ALIGNMENT-byte aligned */
+#define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
+
+/*
+ * add_range - As directed by request opnum in trace tracenum,
+ *     we've just called the student's mm_malloc to allocate a block of 
+ *     size bytes at addr lo. After checking the block for correctness,
+ *     we create a range struct for this block and add it to the range list. 
+ */
+int add_range(range_t **ranges, char *lo, int size, 
+	      int tracenum, int opnum)
+{
+    char *hi = lo + size - 1;
+    range_t *p;
+    char msg[MAXLINE];
+
+    assert(size > 0);
+
+    /* Payload addresses must be ALIGNMENT-byte aligned */
+    if (!IS_ALIGNED(lo)) {
+	sprintf(msg, "Payload address (%p) not aligned to %d bytes", 
+		lo, ALIGNMENT);
+        malloc_error(tracenum, opnum, msg);
+        return 0;
+    }
+
+    /* The payload must lie within the extent of the heap */
+    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
+	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
+		lo, hi, mem_heap_lo(), mem_heap_hi());
+	malloc_error(tracenum, opnum, msg);
+        return 0;
+    }
+
+    /* The payload must not overlap any other payloads */
+    for (p = *ranges;  p != NULL;  p = p->next) {
+        if ((lo >= p->lo && lo <= p-> hi) ||
+            (hi >= p->lo && hi <= p->hi) ||
+            (lo < p->lo && hi > p->hi)) {
+	    sprintf(msg, "Payload (%p:%p) overlaps another payload (%p:%p)\n",
+		    lo, hi, p->lo, p->hi);
+	    malloc_error(tracenum, opnum, msg);
+	    return 0;
+        }
+    }
+
+    /* 
+     * Everything looks OK, so remember the extent of this block 
+     * by creating a range struct and adding it the range list.
+     */
+    if ((p = (range_t *)malloc(sizeof(range_t))) == NULL) {
+	fprintf(stderr, "malloc error in add_range: %s\n", strerror(errno));
+	exit(1);
+    }
+    p->next = *ranges;
+    p->lo = lo;
+    p->hi = hi;
+    *ranges = p;
+    return 1;
+}
+
+/* 
+ * remove_range - Free the range record of block whose payload starts at lo 
+ */
+void remove_range(range_t **ranges, char *lo)
+{
+    range_t *p;
+    range_t **prevpp = ranges;
+    // int size;
+
+    for (p = *ranges;  p != NULL; p = p->next) {
+        if (p->lo == lo) {
+	    *prevpp = p->next;
+            // size = p->hi - p->lo + 1;
+            free(p);
+            break;
+        }
+        prevpp = &(p->next);
+    }
+}
+
+/*
+ * clear_ranges - free all of the range records for a trace 
+ */
+void clear_ranges(range_t **ranges)
+{
+    range_t *p;
+    range_t *pnext;
+
+    for (p = *ranges;  p != NULL;  p = pnext) {
+        pnext = p->next;
+        free(p);
+    }
+    *ranges = NULL;
+}
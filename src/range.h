@@ -0,0 +1,24 @@
+/*
+ * range.h - The range list of allocated payloads, shared by mdriver 
+ *     and mmfuzz
+ */
+#ifndef __RANGE_H_
+#define __RANGE_H_
+
+/* Records the extent of each block's payload */
+typedef struct range_t {
+    char *lo;              /* low payload address */
+    char *hi;              /* high payload address */
+    struct range_t *next;  /* next list element */
+} range_t;
+
+/* Check a new payload of size bytes at lo and add it to the list; 
+   returns 0 and calls malloc_error if the payload is bad */
+int add_range(range_t **ranges, char *lo, int size, int tracenum, int opnum);
+void remove_range(range_t **ranges, char *lo);
+void clear_ranges(range_t **ranges);
+
+/* Reports a bad payload; provided by the program using the range list */
+void malloc_error(int tracenum, int opnum, char *msg);
+
+#endif /* __RANGE_H_ */
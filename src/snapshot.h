@@ -0,0 +1,40 @@
+/*
+ * snapshot.h - Binary heap snapshots
+ *
+ * mdriver -D <file> writes the block layout of the heap after the ops
+ * chosen with -d, taken during the utilization replay; snapview renders
+ * them. A snapshot is a snap_header_t followed by nblocks snap_block_t
+ * in address order, in the byte order of the machine that wrote it.
+ */
+#ifndef __SNAPSHOT_H_
+#define __SNAPSHOT_H_
+
+#include <stdint.h>
+
+#define SNAP_MAGIC   0x70616e73   /* "snap" */
+#define SNAP_VERSION 1
+#define SNAP_NAMELEN 32
+
+typedef struct {
+    uint32_t magic;               /* SNAP_MAGIC */
+    uint32_t version;             /* SNAP_VERSION */
+    char allocator[SNAP_NAMELEN]; /* allocator name, as in mdriver tables */
+    int32_t trace;                /* trace number */
+    int32_t op;                   /* the snapshot is taken after this op... */
+    int32_t type;                 /* ...of type 'a', 'r' or 'f'... */
+    int32_t id;                   /* ...on this block id */
+    uint32_t live;                /* live payload bytes */
+    uint32_t heapsize;            /* heap size (mem_heapsize) */
+    uint32_t nlists;              /* number of free lists */
+    uint32_t nblocks;             /* number of snap_block_t that follow */
+} snap_header_t;
+
+typedef struct {
+    uint32_t offset;              /* payload offset from the heap start */
+    uint32_t size;                /* block size, including overhead */
+    uint16_t overhead;            /* bytes used by the allocator */
+    uint8_t free;                 /* is the block free? */
+    int8_t list;                  /* free list holding it, -1 if allocated */
+} snap_block_t;
+
+#endif /* __SNAPSHOT_H_ */
@@ -0,0 +1,323 @@
+/*
+ * snapview.c - render heap snapshots written by mdriver -D
+ *
+ * For each snapshot (see snapshot.h) snapview prints
+ *   - a summary: heap size, allocated and free blocks and bytes, and the
+ *     external fragmentation 1 - largest free block / free bytes,
+ *   - a fragmentation map of the heap, one character per cell of
+ *     heapsize / (width * rows) bytes, by the free share of the block
+ *     bytes in the cell: '#' none, '+' under half, '-' half or more,
+ *     '.' all, ' ' no blocks (allocator metadata),
+ *   - the free block size spectrum, by power of two and by free list,
+ *   - the holes created since the previous snapshot of the same trace:
+ *     free blocks that were not there before. Taking a snapshot after
+ *     every op (mdriver -d %1) thus shows which ops leave holes behind.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+
+#define NBUCKETS   32   /* power of two size buckets */
+#define NHOLES     5    /* largest new holes to list */
+
+static int width = 64;      /* map columns (-w) */
+static int rows = 16;       /* map rows (-r) */
+static int show_map = 1;    /* print the map (cleared by -n) */
+
+/* One snapshot in memory */
+typedef struct {
+    snap_header_t hdr;
+    snap_block_t *blocks;
+} snap_t;
+
+/*
+ * app_error - report an error and exit
+ */
+static void app_error(char *msg)
+{
+    fprintf(stderr, "snapview: %s\n", msg);
+    exit(1);
+}
+
+/*
+ * read_snap - read the next snapshot from fp; returns 0 at the end
+ */
+static int read_snap(FILE *fp, snap_t *snap)
+{
+    if (fread(&snap->hdr, sizeof(snap->hdr), 1, fp) != 1)
+	return 0;
+    if (snap->hdr.magic != SNAP_MAGIC || snap->hdr.version != SNAP_VERSION)
+	app_error("not a heap snapshot file (or another version)");
+    if ((snap->blocks = malloc((snap->hdr.nblocks + 1) *
+			       sizeof(snap_block_t))) == NULL)
+	app_error("out of memory");
+    if (fread(snap->blocks, sizeof(snap_block_t), snap->hdr.nblocks, fp) !=
+	snap->hdr.nblocks)
+	app_error("truncated snapshot");
+    return 1;
+}
+
+/*
+ * bucket - the power of two bucket of v: bucket b holds [2^b, 2^(b+1))
+ */
+static int bucket(unsigned long v)
+{
+    int b = 0;
+
+    while (v > 1 && b < NBUCKETS - 1) {
+	v >>= 1;
+	b++;
+    }
+    return b;
+}
+
+/*
+ * print_summary - block and byte counts and external fragmentation
+ */
+static void print_summary(snap_t *snap)
+{
+    unsigned long abytes = 0, fbytes = 0, largest = 0;
+    int i, nfree = 0;
+    snap_block_t *b;
+
+    for (i = 0; i < snap->hdr.nblocks; i++) {
+	b = &snap->blocks[i];
+	if (b->free) {
+	    nfree++;
+	    fbytes += b->size;
+	    if (b->size > largest)
+		largest = b->size;
+	} else
+	    abytes += b->size;
+    }
+    printf("  heap %u bytes, %u blocks: %u allocated (%lu bytes), "
+	   "%d free (%lu bytes)\n", snap->hdr.heapsize, snap->hdr.nblocks,
+	   snap->hdr.nblocks - nfree, abytes, nfree, fbytes);
+    printf("  live payload %u bytes (%.1f%% of the heap), largest free "
+	   "block %lu, external fragmentation %.1f%%\n", snap->hdr.live,
+	   snap->hdr.heapsize ? 100.0 * snap->hdr.live / snap->hdr.heapsize : 0,
+	   largest, fbytes ? 100.0 * (1 - (double)largest / fbytes) : 0);
+}
+
+/*
+ * print_map - the fragmentation map
+ */
+static void print_map(snap_t *snap)
+{
+    unsigned long cells = (unsigned long)width * rows, cell, c, lo, hi;
+    unsigned long *used, *freed;
+    snap_block_t *b;
+    int i;
+
+    if (snap->hdr.heapsize == 0)
+	return;
+    cell = (snap->hdr.heapsize + cells - 1) / cells;
+    cells = (snap->hdr.heapsize + cell - 1) / cell;
+    used = calloc(cells, sizeof(unsigned long));
+    freed = calloc(cells, sizeof(unsigned long));
+    if (!used || !freed)
+	app_error("out of memory");
+
+    /* spread each block over the cells it covers */
+    for (i = 0; i < snap->hdr.nblocks; i++) {
+	b = &snap->blocks[i];
+	for (lo = b->offset; lo < (unsigned long)b->offset + b->size; lo = hi) {
+	    c = lo / cell;
+	    if (c >= cells)
+		break;
+	    hi = (c + 1) * cell;
+	    if (hi > (unsigned long)b->offset + b->size)
+		hi = b->offset + b->size;
+	    if (b->free)
+		freed[c] += hi - lo;
+	    else
+		used[c] += hi - lo;
+	}
+    }
+
+    printf("\n  Map (%lu bytes per cell; free share '#' none, '+' < 50%%, "
+	   "'-' >= 50%%, '.' all):\n", cell);
+    for (c = 0; c < cells; c++) {
+	if (c % width == 0)
+	    printf("  %8lu |", c * cell);
+	putchar(!used[c] && !freed[c] ? ' ' : !freed[c] ? '#' :
+		!used[c] ? '.' : freed[c] < used[c] ? '+' : '-');
+	if (c % width == width - 1 || c == cells - 1)
+	    printf("|\n");
+    }
+    free(used);
+    free(freed);
+}
+
+/*
+ * print_spectrum - free block sizes by power of two and by free list
+ */
+static void print_spectrum(snap_t *snap)
+{
+    unsigned long count[NBUCKETS] = {0}, bytes[NBUCKETS] = {0}, total = 0;
+    unsigned long *lcount, *lbytes;
+    snap_block_t *b;
+    int i, nl = snap->hdr.nlists;
+
+    lcount = calloc(nl + 1, sizeof(unsigned long));
+    lbytes = calloc(nl + 1, sizeof(unsigned long));
+    if (!lcount || !lbytes)
+	app_error("out of memory");
+    for (i = 0; i < snap->hdr.nblocks; i++) {
+	b = &snap->blocks[i];
+	if (!b->free)
+	    continue;
+	count[bucket(b->size)]++;
+	bytes[bucket(b->size)] += b->size;
+	total += b->size;
+	if (b->list >= 0 && b->list < nl) {
+	    lcount[b->list]++;
+	    lbytes[b->list] += b->size;
+	}
+    }
+    if (total == 0) {
+	printf("\n  No free blocks\n");
+	free(lcount);
+	free(lbytes);
+	return;
+    }
+
+    printf("\n  Free block sizes:\n");
+    printf("  %22s %8s %10s %7s\n", "size (bytes)", "blocks", "bytes", "%");
+    for (i = 0; i < NBUCKETS; i++)
+	if (count[i])
+	    printf("  %10lu .. %9lu %8lu %10lu %6.1f%%\n", 1UL << i,
+		   (2UL << i) - 1, count[i], bytes[i], 100.0 * bytes[i] / total);
+    if (nl > 0) {
+	printf("\n  Free lists:\n");
+	printf("  %22s %8s %10s %7s\n", "list", "blocks", "bytes", "%");
+	for (i = 0; i < nl; i++)
+	    if (lcount[i])
+		printf("  %22d %8lu %10lu %6.1f%%\n", i, lcount[i], lbytes[i],
+		       100.0 * lbytes[i] / total);
+    }
+    free(lcount);
+    free(lbytes);
+}
+
+/*
+ * cmp_size - order blocks by decreasing size
+ */
+static int cmp_size(const void *a, const void *b)
+{
+    const snap_block_t *x = a, *y = b;
+
+    return (x->size < y->size) - (x->size > y->size);
+}
+
+/*
+ * print_holes - free blocks of snap that prev does not have. Both are in
+ *     address order, so one merge pass finds them.
+ */
+static void print_holes(snap_t *prev, snap_t *snap)
+{
+    snap_block_t *holes, *b, *p;
+    unsigned long bytes = 0;
+    int i, j = 0, n = 0;
+    long grown = (long)snap->hdr.heapsize - prev->hdr.heapsize;
+
+    if ((holes = malloc((snap->hdr.nblocks + 1) *
+			sizeof(snap_block_t))) == NULL)
+	app_error("out of memory");
+    for (i = 0; i < snap->hdr.nblocks; i++) {
+	b = &snap->blocks[i];
+	if (!b->free)
+	    continue;
+	while (j < prev->hdr.nblocks && prev->blocks[j].offset < b->offset)
+	    j++;
+	p = j < prev->hdr.nblocks ? &prev->blocks[j] : NULL;
+	if (p && p->offset == b->offset && p->size == b->size && p->free)
+	    continue;
+	holes[n++] = *b;
+	bytes += b->size;
+    }
+
+    printf("\n  Since op %d: heap %+ld bytes, %d new free blocks "
+	   "(%lu bytes)\n", prev->hdr.op, grown, n, bytes);
+    qsort(holes, n, sizeof(snap_block_t), cmp_size);
+    for (i = 0; i < n && i < NHOLES; i++)
+	printf("  %8u bytes at offset %u\n", holes[i].size, holes[i].offset);
+    free(holes);
+}
+
+/*
+ * usage - explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: snapview [-hn] [-w <cols>] [-r <rows>] "
+	    "<file>\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-n         Do not print fragmentation maps.\n");
+    fprintf(stderr, "\t-r <rows>  Map rows (default 16).\n");
+    fprintf(stderr, "\t-w <cols>  Map columns (default 64).\n");
+}
+
+int main(int argc, char **argv)
+{
+    snap_t prev, snap;
+    int c, have_prev = 0, count = 0;
+    FILE *fp;
+
+    while ((c = getopt(argc, argv, "hnr:w:")) != EOF) {
+	switch (c) {
+	case 'n':
+	    show_map = 0;
+	    break;
+	case 'r':
+	    if ((rows = atoi(optarg)) < 1)
+		app_error("-r expects a positive row count");
+	    break;
+	case 'w':
+	    if ((width = atoi(optarg)) < 1)
+		app_error("-w expects a positive column count");
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (optind != argc - 1) {
+	usage();
+	exit(1);
+    }
+    if ((fp = fopen(argv[optind], "rb")) == NULL) {
+	perror(argv[optind]);
+	exit(1);
+    }
+
+    while (read_snap(fp, &snap)) {
+	printf("Snapshot %d: %s, trace %d, after op %d (%c %d)\n", count++,
+	       snap.hdr.allocator, snap.hdr.trace, snap.hdr.op, snap.hdr.type,
+	       snap.hdr.id);
+	print_summary(&snap);
+	if (show_map)
+	    print_map(&snap);
+	print_spectrum(&snap);
+	if (have_prev && prev.hdr.trace == snap.hdr.trace &&
+	    strcmp(prev.hdr.allocator, snap.hdr.allocator) == 0 &&
+	    prev.hdr.op < snap.hdr.op)
+	    print_holes(&prev, &snap);
+	printf("\n");
+	if (have_prev)
+	    free(prev.blocks);
+	prev = snap;
+	have_prev = 1;
+    }
+    if (have_prev)
+	free(prev.blocks);
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * trace.c - Reads trace files into memory, for mdriver and the trace
+ *     tools. The format is described in traces/README.md.
+ *
+ * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
+ * May not be used, modified, or copied without permission.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "trace.h"
+
+#define MAXLINE     1024 /* max string size */
+
+extern int verbose;      /* -v option of the program */
+
+static void read_tags(char *line, traceop_t *op, char *path);
+
+/*
+ * unix_error - Report a Unix-style error and exit
+ */
+static void unix_error(char *msg) 
+{
+    printf("%s: %s\n", msg, strerror(errno));
+    exit(1);
+}
+
+/*
+ * read_trace - read a trace file and store it in memory
+ */
+trace_t *read_trace(char *tracedir, char *filename)
+{
+    FILE *tracefile;
+    trace_t *trace;
+    char type[MAXLINE];
+    char path[MAXLINE];
+    char line[MAXLINE];
+    unsigned index, size, align;
+    unsigned max_index = 0;
+    unsigned op_index;
+
+    if (verbose > 1)
+	printf("Reading tracefile: %s\n", filename);
+
+    /* Allocate the trace record */
+    if ((trace = (trace_t *) malloc(sizeof(trace_t))) == NULL)
+	unix_error("malloc 1 failed in read_trance");
+	
+    /* Read the trace file header */
+    strcpy(path, tracedir);
+    strcat(path, filename);
+    if ((tracefile = fopen(path, "r")) == NULL) {
+	sprintf(line, "Could not open %s in read_trace", path);
+	unix_error(line);
+    }
+
+    int n_inputs;
+    n_inputs = fscanf(tracefile, "%d", &(trace->sugg_heapsize)); /* not used */
+    n_inputs = fscanf(tracefile, "%d", &(trace->num_ids));     
+    n_inputs = fscanf(tracefile, "%d", &(trace->num_ops));     
+    n_inputs = fscanf(tracefile, "%d", &(trace->weight));        /* not used */
+    // Ignore n_inputs
+    // if(n_inputs != 1)
+    //     exit(EXIT_FAILURE);
+
+    /* We'll store each request line in the trace in this array */
+    if ((trace->ops = 
+	 (traceop_t *)malloc(trace->num_ops * sizeof(traceop_t))) == NULL)
+	unix_error("malloc 2 failed in read_trace");
+
+    /* We'll keep an array of pointers to the allocated blocks here... */
+    if ((trace->blocks = 
+	 (char **)malloc(trace->num_ids * sizeof(char *))) == NULL)
+	unix_error("malloc 3 failed in read_trace");
+
+    /* ... along with the corresponding byte sizes of each block */
+    if ((trace->block_sizes = 
+	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
+	unix_error("malloc 4 failed in read_trace");
+    
+    /* read every request line in the trace file */
+    index = 0;
+    op_index = 0;
+    trace->num_threads = 1;
+    while (fscanf(tracefile, "%s", type) != EOF) {
+	trace->ops[op_index].align = 0;
+	switch(type[0]) {
+	case 'a':
+	    n_inputs = fscanf(tracefile, "%u %u", &index, &size);
+	    if(n_inputs != 2) fprintf(stderr, "option '%c' expect 2 more arguments", type[0]);
+	    trace->ops[op_index].type = ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'm':
+	    n_inputs = fscanf(tracefile, "%u %u %u", &index, &align, &size);
+	    if(n_inputs != 3) fprintf(stderr, "option '%c' expect 3 more arguments", type[0]);
+	    if (align == 0 || (align & (align - 1))) {
+		printf("Bogus alignment (%u) in tracefile %s\n", align, path);
+		exit(1);
+	    }
+	    trace->ops[op_index].type = ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].align = align;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'r':
+	    n_inputs = fscanf(tracefile, "%u %u", &index, &size);
+	    if(n_inputs != 2) fprintf(stderr, "option '%c' expect 2 more arguments", type[0]);
+	    trace->ops[op_index].type = REALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'f':
+	    n_inputs = fscanf(tracefile, "%ud", &index);
+	    if(n_inputs != 1) fprintf(stderr, "option '%c' expect 1 more arguments", type[0]);
+	    trace->ops[op_index].type = FREE;
+	    trace->ops[op_index].index = index;
+	    break;
+	default:
+	    printf("Bogus type character (%c) in tracefile %s\n", 
+		   type[0], path);
+	    exit(1);
+	}
+
+	/* optional tagged columns follow up to the end of the line */
+	if (fgets(line, MAXLINE, tracefile) == NULL)
+	    line[0] = '\0';
+	read_tags(line, &trace->ops[op_index], path);
+	if (trace->ops[op_index].tid >= trace->num_threads)
+	    trace->num_threads = trace->ops[op_index].tid + 1;
+	op_index++;
+	
+    }
+    fclose(tracefile);
+    assert(max_index == trace->num_ids - 1);
+    assert(trace->num_ops == op_index);
+    
+    return trace;
+}
+
+/*
+ * read_tags - parse the optional columns after a request. Each column
+ *     starts with a tag character:
+ *       t<tid>  thread that issues the request (default 0)
+ *       h<hint> lifetime hint of an alloc request, for mm_malloc_hint:
+ *               0 short-lived (default), 1 long-lived
+ */
+static void read_tags(char *line, traceop_t *op, char *path)
+{
+    char *tok;
+
+    op->tid = 0;
+    op->hint = 0;
+    for (tok = strtok(line, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+	switch (tok[0]) {
+	case 't':
+	    op->tid = atoi(tok + 1);
+	    if (op->tid < 0) {
+		printf("Bogus thread id (%s) in tracefile %s\n", tok, path);
+		exit(1);
+	    }
+	    break;
+	case 'h':
+	    op->hint = atoi(tok + 1);
+	    if (op->type != ALLOC || op->hint < 0 || op->hint > 1) {
+		printf("Bogus hint (%s) in tracefile %s\n", tok, path);
+		exit(1);
+	    }
+	    break;
+	default:
+	    printf("Bogus column (%s) in tracefile %s\n", tok, path);
+	    exit(1);
+	}
+    }
+}
+
+/*
+ * free_trace - Free the trace record and the three arrays it points
+ *              to, all of which were allocated in read_trace().
+ */
+void free_trace(trace_t *trace)
+{
+    free(trace->ops);         /* free the three arrays... */
+    free(trace->blocks);      
+    free(trace->block_sizes);
+    free(trace);              /* and the trace record itself... */
+}
@@ -0,0 +1,37 @@
+/*
+ * trace.h - Trace files in memory (see traces/README.md)
+ */
+#ifndef __TRACE_H_
+#define __TRACE_H_
+
+#include <stddef.h>
+
+/* Characterizes a single trace operation (allocator request) */
+typedef struct {
+    enum {ALLOC, FREE, REALLOC} type; /* type of request */
+    int index;                        /* index for free() to use later */
+    int size;                         /* byte size of alloc/realloc request */
+    int tid;                          /* thread that issues the request */
+    int hint;                         /* lifetime hint of an alloc request */
+    int align;                        /* alignment of an alloc request, 0 if none */
+} traceop_t;
+
+/* Holds the information for one trace file*/
+typedef struct {
+    int sugg_heapsize;   /* suggested heap size (unused) */
+    int num_ids;         /* number of alloc/realloc ids */
+    int num_ops;         /* number of distinct requests */
+    int weight;          /* weight for this trace (unused) */
+    int num_threads;     /* number of thread ids used by the requests */
+    traceop_t *ops;      /* array of requests */
+    char **blocks;       /* array of ptrs returned by malloc/realloc... */
+    size_t *block_sizes; /* ... and a corresponding array of payload sizes */
+} trace_t;
+
+/* Read tracedir/filename; exits on errors */
+trace_t *read_trace(char *tracedir, char *filename);
+
+/* Free a trace returned by read_trace */
+void free_trace(trace_t *trace);
+
+#endif /* __TRACE_H_ */
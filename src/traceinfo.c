@@ -0,0 +1,478 @@
+/*
+ * traceinfo.c - describe what the requests of a trace look like
+ *
+ * For each trace file, traceinfo reports
+ *   - a histogram of request sizes (malloc and realloc),
+ *   - object lifetimes, in ops from the malloc to the free of an id,
+ *   - the peak live set (payload bytes and blocks),
+ *   - realloc growth factors and realloc chain lengths per object,
+ *   - how often ids are reused after a free,
+ * and a table of size classes that minimizes the internal fragmentation
+ * of a size-class allocator for the trace: every request is rounded up
+ * to the smallest class that holds it, and the class bounds are chosen
+ * by dynamic programming over the distinct (aligned) request sizes to
+ * minimize the total bytes wasted by rounding. Power-of-two classes, as
+ * the seg lists of mm.c use, are shown for comparison.
+ *
+ * With -H <dir>, traceinfo also writes a copy of each trace to <dir> in
+ * which every malloc whose block lives longer than a quarter of the
+ * trace carries the long-lived hint h1 (see traces/README.md), for
+ * evaluating mm_malloc_hint.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+#include "config.h"
+
+#define NBUCKETS     32   /* power of two histogram buckets */
+#define MAXCLASSES   64   /* max size classes (-k) */
+
+int verbose = 0;          /* read by read_trace */
+
+static int num_classes = 13;        /* size classes to recommend (-k) */
+static int align = ALIGNMENT;       /* request size rounding (-a) */
+static char *hint_dir = NULL;       /* where to write hinted traces (-H) */
+
+/*
+ * app_error - report an error and exit
+ */
+static void app_error(char *msg)
+{
+    fprintf(stderr, "traceinfo: %s\n", msg);
+    exit(1);
+}
+
+/*
+ * bucket - the power of two histogram bucket of v: bucket b holds
+ *     values in [2^(b-1), 2^b), bucket 0 holds 0
+ */
+static int bucket(long v)
+{
+    int b = 0;
+
+    while (v > 0 && b < NBUCKETS - 1) {
+	v >>= 1;
+	b++;
+    }
+    return b;
+}
+
+/*
+ * print_histogram - print the non-empty buckets of a histogram, with
+ *     the share of the count and, if given, of a weight such as bytes
+ */
+static void print_histogram(char *what, long *count, double *weight)
+{
+    long total = 0;
+    double wtotal = 0;
+    int b;
+
+    for (b = 0; b < NBUCKETS; b++) {
+	total += count[b];
+	wtotal += weight ? weight[b] : 0;
+    }
+    if (total == 0)
+	return;
+    printf("  %-22s %10s %7s", what, "count", "%");
+    if (weight)
+	printf(" %8s", "% bytes");
+    printf("\n");
+    for (b = 0; b < NBUCKETS; b++) {
+	if (count[b] == 0)
+	    continue;
+	if (b == 0)
+	    printf("  %22s", "0");
+	else
+	    printf("  %10ld .. %9ld", 1L << (b - 1), (1L << b) - 1);
+	printf(" %10ld %6.1f%%", count[b], 100.0 * count[b] / total);
+	if (weight)
+	    printf(" %7.1f%%", wtotal > 0 ? 100.0 * weight[b] / wtotal : 0);
+	printf("\n");
+    }
+}
+
+/*
+ * print_sizes - size histogram
+ */
+static void print_sizes(trace_t *trace)
+{
+    long count[NBUCKETS] = {0};
+    double bytes[NBUCKETS] = {0};
+    int i, b;
+
+    for (i = 0; i < trace->num_ops; i++) {
+	if (trace->ops[i].type == FREE)
+	    continue;
+	b = bucket(trace->ops[i].size);
+	count[b]++;
+	bytes[b] += trace->ops[i].size;
+    }
+    printf("\nRequest sizes (malloc and realloc):\n");
+    print_histogram("size (bytes)", count, bytes);
+}
+
+/*
+ * print_lifetimes - lifetimes, peak live set, realloc statistics and
+ *     id reuse
+ */
+static void print_lifetimes(trace_t *trace)
+{
+    long life[NBUCKETS] = {0}, chains[NBUCKETS] = {0};
+    long growth[8] = {0};
+    static char *growth_name[8] = {"< 0.5", "0.5 .. 1", "1", "1 .. 1.25",
+				   "1.25 .. 1.5", "1.5 .. 2", "2 .. 4", ">= 4"};
+    int *born, *reallocs, *uses, i, id, size, old, g;
+    long objects = 0, never_freed = 0, reused_ids = 0, reuses = 0;
+    long max_chain = 0, live_blocks = 0, peak_blocks = 0;
+    double live = 0, peak = 0, life_sum = 0, f;
+    int peak_op = 0;
+
+    born = malloc(trace->num_ids * sizeof(int));
+    reallocs = calloc(trace->num_ids, sizeof(int));
+    uses = calloc(trace->num_ids, sizeof(int));
+    if (!born || !reallocs || !uses)
+	app_error("out of memory");
+    for (i = 0; i < trace->num_ids; i++)
+	born[i] = -1;
+
+    for (i = 0; i < trace->num_ops; i++) {
+	id = trace->ops[i].index;
+	size = trace->ops[i].size;
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    born[id] = i;
+	    reallocs[id] = 0;
+	    trace->block_sizes[id] = size;
+	    if (uses[id]++ == 1)
+		reused_ids++;
+	    if (uses[id] > 1)
+		reuses++;
+	    live += size;
+	    live_blocks++;
+	    break;
+	case REALLOC:
+	    old = trace->block_sizes[id];
+	    f = old > 0 ? (double)size / old : 4;
+	    g = f < 0.5 ? 0 : f < 1 ? 1 : f == 1 ? 2 : f < 1.25 ? 3 :
+		f < 1.5 ? 4 : f < 2 ? 5 : f < 4 ? 6 : 7;
+	    growth[g]++;
+	    reallocs[id]++;
+	    trace->block_sizes[id] = size;
+	    live += size - old;
+	    break;
+	case FREE:
+	    life[bucket(i - born[id])]++;
+	    life_sum += i - born[id];
+	    chains[bucket(reallocs[id])]++;
+	    if (reallocs[id] > max_chain)
+		max_chain = reallocs[id];
+	    objects++;
+	    live -= trace->block_sizes[id];
+	    live_blocks--;
+	    born[id] = -1;
+	    break;
+	}
+	if (live > peak) {
+	    peak = live;
+	    peak_op = i;
+	}
+	if (live_blocks > peak_blocks)
+	    peak_blocks = live_blocks;
+    }
+
+    /* objects still live at the end live until the last op */
+    for (id = 0; id < trace->num_ids; id++) {
+	if (born[id] < 0)
+	    continue;
+	never_freed++;
+	objects++;
+	life[bucket(trace->num_ops - born[id])]++;
+	life_sum += trace->num_ops - born[id];
+	chains[bucket(reallocs[id])]++;
+	if (reallocs[id] > max_chain)
+	    max_chain = reallocs[id];
+    }
+
+    printf("\nObject lifetimes (ops from malloc to free; %ld objects, "
+	   "%ld never freed, mean %.1f):\n", objects, never_freed,
+	   objects ? life_sum / objects : 0);
+    print_histogram("lifetime (ops)", life, NULL);
+
+    printf("\nPeak live set: %.0f payload bytes at op %d, "
+	   "%ld blocks at most\n", peak, peak_op, peak_blocks);
+
+    if (max_chain == 0)
+	printf("\nNo reallocs\n");
+    else {
+	printf("\nRealloc growth factors (new size / old size):\n");
+	printf("  %-22s %10s\n", "factor", "count");
+	for (g = 0; g < 8; g++)
+	    if (growth[g])
+		printf("  %22s %10ld\n", growth_name[g], growth[g]);
+	printf("\nRealloc chains (reallocs per object; longest %ld):\n",
+	       max_chain);
+	print_histogram("reallocs", chains, NULL);
+    }
+
+    printf("\nId reuse: %ld of %d ids are reused after a free, "
+	   "%ld reuses in all\n", reused_ids, trace->num_ids, reuses);
+
+    free(born);
+    free(reallocs);
+    free(uses);
+}
+
+/*
+ * print_classes - recommend size class bounds for the trace
+ *
+ * With the distinct aligned request sizes s[1] < ... < s[m] requested
+ * c[1..m] times, a class with upper bound s[i] that holds s[j+1..i]
+ * wastes sum c[t] * (s[i] - s[t]) bytes. best[k][i] is the least waste
+ * for s[1..i] with k classes, the last one ending at s[i].
+ */
+static void print_classes(trace_t *trace)
+{
+    int *asize, m = 0, i, j, k, t, K, maxsize = 0, lo;
+    double *c, *cs, *cw, *best, *prev, w, total = 0, bytes = 0, pow2 = 0;
+    int *from, *bound;
+    long cap;
+
+    /* distinct aligned sizes and their counts */
+    for (i = 0; i < trace->num_ops; i++)
+	if (trace->ops[i].type != FREE && trace->ops[i].size > maxsize)
+	    maxsize = trace->ops[i].size;
+    cap = maxsize / align + 2;
+    if ((c = calloc(cap, sizeof(double))) == NULL)
+	app_error("out of memory");
+    for (i = 0; i < trace->num_ops; i++) {
+	if (trace->ops[i].type == FREE)
+	    continue;
+	c[(trace->ops[i].size + align - 1) / align]++;
+	total++;
+	bytes += trace->ops[i].size;
+    }
+    if (total == 0) {
+	free(c);
+	return;
+    }
+    asize = malloc(cap * sizeof(int));
+    cs = malloc((cap + 1) * sizeof(double));  /* prefix sums of c */
+    cw = malloc((cap + 1) * sizeof(double));  /* ...and of c * size */
+    if (!asize || !cs || !cw)
+	app_error("out of memory");
+    cs[0] = cw[0] = 0;
+    for (i = 0; i < cap; i++) {
+	if (c[i] == 0)
+	    continue;
+	asize[m] = i * align;
+	c[m] = c[i];
+	cs[m + 1] = cs[m] + c[m];
+	cw[m + 1] = cw[m] + c[m] * asize[m];
+	m++;
+    }
+
+    /* the waste of a class holding sizes j..i-1 (0-based, i exclusive) */
+#define WASTE(j, i) ((cs[i] - cs[j]) * asize[(i) - 1] - (cw[i] - cw[j]))
+
+    K = num_classes < m ? num_classes : m;
+    best = malloc((m + 1) * sizeof(double));
+    prev = malloc((m + 1) * sizeof(double));
+    from = malloc((size_t)(K + 1) * (m + 1) * sizeof(int));
+    bound = malloc((K + 1) * sizeof(int));
+    if (!best || !prev || !from || !bound)
+	app_error("out of memory");
+
+    for (i = 1; i <= m; i++) {
+	prev[i] = WASTE(0, i);
+	from[1 * (m + 1) + i] = 0;
+    }
+    prev[0] = 0;
+    for (k = 2; k <= K; k++) {
+	best[0] = 0;
+	for (i = 1; i <= m; i++) {
+	    best[i] = prev[i];  /* fewer classes are allowed too */
+	    from[k * (m + 1) + i] = -1;
+	    for (j = k - 1; j < i; j++) {
+		w = prev[j] + WASTE(j, i);
+		if (w < best[i]) {
+		    best[i] = w;
+		    from[k * (m + 1) + i] = j;
+		}
+	    }
+	}
+	memcpy(prev, best, (m + 1) * sizeof(double));
+    }
+
+    /* walk back from the largest size to find the class bounds */
+    t = 0;
+    for (i = m, k = K; i > 0 && k > 0; k--) {
+	j = from[k * (m + 1) + i];
+	if (j < 0)
+	    continue;  /* k-1 classes did as well */
+	bound[t++] = i - 1;
+	i = j;
+    }
+
+    /* power-of-two classes for comparison */
+    for (i = 0; i < m; i++) {
+	for (w = align; w < asize[i]; w *= 2)
+	    ;
+	pow2 += c[i] * (w - asize[i]);
+    }
+
+    printf("\nRecommended size classes (%d, %d-byte aligned, %.0f requests):\n",
+	   t, align, total);
+    printf("  %10s %10s %10s %8s\n", "from", "to", "requests", "waste");
+    lo = align;
+    for (k = t - 1; k >= 0; k--) {
+	j = (k == t - 1) ? 0 : bound[k + 1] + 1;
+	i = bound[k] + 1;
+	printf("  %10d %10d %10.0f %7.1f%%\n", lo, asize[bound[k]],
+	       cs[i] - cs[j],
+	       100.0 * WASTE(j, i) / (cw[i] - cw[j] + WASTE(j, i)));
+	lo = asize[bound[k]] + 1;
+    }
+    printf("  Rounding waste: %.1f%% of requested bytes with these classes, "
+	   "%.1f%% with power-of-two classes\n",
+	   100.0 * prev[m] / bytes, 100.0 * pow2 / bytes);
+#undef WASTE
+
+    free(c);
+    free(asize);
+    free(cs);
+    free(cw);
+    free(best);
+    free(prev);
+    free(from);
+    free(bound);
+}
+
+/*
+ * write_hinted - write trace, read from path, to hint_dir with the
+ *     long-lived hint on every malloc whose block is freed more than a
+ *     quarter of the trace later, or never
+ */
+static void write_hinted(trace_t *trace, char *path)
+{
+    char name[1024], *base;
+    char *hint;
+    int *born, i, id;
+    traceop_t *op;
+    FILE *fp;
+
+    born = malloc(trace->num_ids * sizeof(int));
+    hint = calloc(trace->num_ops, 1);
+    if (!born || !hint)
+	app_error("out of memory");
+    for (id = 0; id < trace->num_ids; id++)
+	born[id] = -1;
+    for (i = 0; i < trace->num_ops; i++) {
+	id = trace->ops[i].index;
+	if (trace->ops[i].type == ALLOC)
+	    born[id] = i;
+	else if (trace->ops[i].type == FREE && born[id] >= 0) {
+	    hint[born[id]] = (i - born[id] > trace->num_ops / 4);
+	    born[id] = -1;
+	}
+    }
+    /* the blocks never freed live to the end of the trace */
+    for (id = 0; id < trace->num_ids; id++)
+	if (born[id] >= 0)
+	    hint[born[id]] = (trace->num_ops - born[id] > trace->num_ops / 4);
+
+    base = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    snprintf(name, sizeof(name), "%s/%s", hint_dir, base);
+    if ((fp = fopen(name, "w")) == NULL)
+	app_error("could not write a hinted trace to the -H directory");
+    fprintf(fp, "%d\n%d\n%d\n%d\n", trace->sugg_heapsize, trace->num_ids,
+	    trace->num_ops, trace->weight);
+    for (i = 0; i < trace->num_ops; i++) {
+	op = &trace->ops[i];
+	if (op->type == FREE)
+	    fprintf(fp, "f %d", op->index);
+	else if (op->type == REALLOC)
+	    fprintf(fp, "r %d %d", op->index, op->size);
+	else if (op->align)
+	    fprintf(fp, "m %d %d %d", op->index, op->align, op->size);
+	else
+	    fprintf(fp, "a %d %d", op->index, op->size);
+	if (op->tid)
+	    fprintf(fp, " t%d", op->tid);
+	if (hint[i])
+	    fprintf(fp, " h1");
+	fprintf(fp, "\n");
+    }
+    fclose(fp);
+    printf("Hinted copy: %s\n", name);
+    free(born);
+    free(hint);
+}
+
+/*
+ * usage - explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: traceinfo [-h] [-k <classes>] [-a <align>] "
+	    "[-H <dir>] <trace>...\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-a <align>    Round request sizes to <align> bytes "
+	    "(default %d).\n", ALIGNMENT);
+    fprintf(stderr, "\t-H <dir>      Write copies of the traces with "
+	    "long-lived hints to <dir>.\n");
+    fprintf(stderr, "\t-h            Print this message.\n");
+    fprintf(stderr, "\t-k <classes>  Number of size classes to recommend "
+	    "(default 13).\n");
+}
+
+int main(int argc, char **argv)
+{
+    trace_t *trace;
+    int c;
+
+    while ((c = getopt(argc, argv, "k:a:H:h")) != EOF) {
+	switch (c) {
+	case 'H':
+	    hint_dir = optarg;
+	    break;
+	case 'k':
+	    num_classes = atoi(optarg);
+	    if (num_classes < 1 || num_classes > MAXCLASSES)
+		app_error("-k expects 1 to 64 classes");
+	    break;
+	case 'a':
+	    align = atoi(optarg);
+	    if (align < 1)
+		app_error("-a expects a positive alignment");
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (optind == argc) {
+	usage();
+	exit(1);
+    }
+
+    for (; optind < argc; optind++) {
+	trace = read_trace("", argv[optind]);
+	printf("%s: %d ops, %d ids, %d thread%s\n", argv[optind],
+	       trace->num_ops, trace->num_ids, trace->num_threads,
+	       trace->num_threads > 1 ? "s" : "");
+	print_sizes(trace);
+	print_lifetimes(trace);
+	print_classes(trace);
+	if (hint_dir)
+	    write_hinted(trace, argv[optind]);
+	printf("\n");
+	free_trace(trace);
+    }
+    return 0;
+}
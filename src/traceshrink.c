@@ -0,0 +1,461 @@
+/*
+ * traceshrink.c - shrink a trace on which an allocator fails
+ *
+ * traceshrink replays a failing trace with mdriver, notes the class of
+ * the first "ERROR [trace ...]" line (the malloc_error message with its
+ * addresses and numbers stripped) or the signal that killed mdriver, and
+ * then delta-debugs the trace: it repeatedly removes whole id
+ * lifecycles and single realloc/free requests, and keeps every smaller
+ * trace that still fails with the same class. Candidates are always
+ * well-formed: every id starts with an alloc, and no id is used after it
+ * was freed. Ids are renumbered densely and the header is rewritten, so
+ * the result is an ordinary trace file that mdriver -f accepts.
+ *
+ * Each candidate costs one mdriver run, so a 30000 op trace takes a few
+ * hundred to a few thousand runs, depending on how local the bug is.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MAXLINE     1024  /* max line length in a trace or mdriver output */
+#define MAXARGS       32  /* max mdriver arguments */
+
+/* One request of the trace */
+typedef struct {
+    char type;            /* 'a', 'm', 'r' or 'f' */
+    int id;               /* block id, as in the original trace */
+    int align;            /* alignment ('m' only) */
+    int size;             /* request size (alloc and realloc only) */
+    char *tags;           /* optional columns, copied verbatim */
+} op_t;
+
+static op_t *ops;                 /* the original trace... */
+static int num_ops, num_ids;      /* ...its size... */
+static int heapsize, weight;      /* ...and the unused header fields */
+static char *keep;                /* ops of the smallest failing trace */
+
+static char *mdriver = "./mdriver";   /* driver to run (-m) */
+static char *driver_args[MAXARGS];    /* extra driver arguments (-a) */
+static int num_driver_args = 0;
+static int timeout = 60;              /* secs before a run is a hang (-s) */
+static char tmpname[64];              /* candidate trace, in the cwd */
+static char target[MAXLINE];          /* failure class to preserve */
+static int runs = 0;                  /* number of mdriver runs */
+
+/*
+ * app_error - report an error and exit
+ */
+static void app_error(char *msg, char *arg)
+{
+    fprintf(stderr, "traceshrink: %s%s\n", msg, arg ? arg : "");
+    unlink(tmpname);
+    exit(1);
+}
+
+/*
+ * read_trace - read a trace file into ops
+ */
+static void read_trace(char *path)
+{
+    FILE *fp;
+    char line[MAXLINE], type[MAXLINE], *p;
+    int n, cap = 0;
+
+    if ((fp = fopen(path, "r")) == NULL)
+	app_error("could not open ", path);
+    if (fscanf(fp, "%d %d %d %d", &heapsize, &num_ids, &n, &weight) != 4)
+	app_error("bad trace header in ", path);
+
+    num_ops = 0;
+    while (fgets(line, MAXLINE, fp) != NULL) {
+	if (sscanf(line, "%s", type) != 1)
+	    continue; /* blank line */
+	if (num_ops == cap) {
+	    cap = cap ? 2 * cap : 1024;
+	    if ((ops = realloc(ops, cap * sizeof(op_t))) == NULL)
+		app_error("out of memory", NULL);
+	}
+	ops[num_ops].type = type[0];
+	ops[num_ops].size = 0;
+	p = line + strspn(line, " \t");
+	p += strcspn(p, " \t");  /* skip the type */
+	switch (type[0]) {
+	case 'a':
+	case 'r':
+	    if (sscanf(p, "%d %d", &ops[num_ops].id, &ops[num_ops].size) != 2)
+		app_error("bad request in ", path);
+	    p += strspn(p, " \t");
+	    p += strcspn(p, " \t"); /* skip the id */
+	    break;
+	case 'm':
+	    if (sscanf(p, "%d %d %d", &ops[num_ops].id, &ops[num_ops].align,
+		       &ops[num_ops].size) != 3)
+		app_error("bad request in ", path);
+	    p += strspn(p, " \t");
+	    p += strcspn(p, " \t"); /* skip the id... */
+	    p += strspn(p, " \t");
+	    p += strcspn(p, " \t"); /* ...and the alignment */
+	    break;
+	case 'f':
+	    if (sscanf(p, "%d", &ops[num_ops].id) != 1)
+		app_error("bad request in ", path);
+	    break;
+	default:
+	    app_error("bad request type in ", path);
+	}
+	/* the ids index per-id arrays of num_ids entries */
+	if (ops[num_ops].id < 0 || ops[num_ops].id >= num_ids)
+	    app_error("request id out of range in ", path);
+	p += strspn(p, " \t");
+	p += strcspn(p, " \t\r\n"); /* skip the last fixed field */
+	p += strspn(p, " \t");
+	p[strcspn(p, "\r\n")] = '\0';
+	if ((ops[num_ops].tags = strdup(p)) == NULL)
+	    app_error("out of memory", NULL);
+	num_ops++;
+    }
+    fclose(fp);
+    if (n != num_ops)
+	fprintf(stderr, "traceshrink: header says %d ops, found %d\n",
+		n, num_ops);
+}
+
+/*
+ * well_formed - is the trace made of the ops in sel a valid trace?
+ */
+static int well_formed(char *sel)
+{
+    char *state;  /* per id: 0 = never allocated, 1 = live, 2 = freed */
+    int i, ok = 1;
+
+    if ((state = calloc(num_ids, 1)) == NULL)
+	app_error("out of memory", NULL);
+    for (i = 0; i < num_ops && ok; i++) {
+	if (!sel[i])
+	    continue;
+	if (ops[i].type == 'a' || ops[i].type == 'm')
+	    ok = (state[ops[i].id] != 1);
+	else
+	    ok = (state[ops[i].id] == 1);
+	state[ops[i].id] = (ops[i].type == 'f') ? 2 : 1;
+    }
+    free(state);
+    return ok;
+}
+
+/*
+ * write_trace - write the ops in sel as a trace file, with the ids
+ *     renumbered in order of first use
+ */
+static void write_trace(char *path, char *sel)
+{
+    FILE *fp;
+    int *newid;
+    int i, n = 0, nids = 0;
+
+    if ((newid = malloc(num_ids * sizeof(int))) == NULL)
+	app_error("out of memory", NULL);
+    for (i = 0; i < num_ids; i++)
+	newid[i] = -1;
+    for (i = 0; i < num_ops; i++) {
+	if (!sel[i])
+	    continue;
+	n++;
+	if (newid[ops[i].id] < 0)
+	    newid[ops[i].id] = nids++;
+    }
+
+    if ((fp = fopen(path, "w")) == NULL)
+	app_error("could not write ", path);
+    fprintf(fp, "%d\n%d\n%d\n%d\n", heapsize, nids, n, weight);
+    for (i = 0; i < num_ops; i++) {
+	if (!sel[i])
+	    continue;
+	if (ops[i].type == 'f')
+	    fprintf(fp, "f %d", newid[ops[i].id]);
+	else if (ops[i].type == 'm')
+	    fprintf(fp, "m %d %d %d", newid[ops[i].id], ops[i].align,
+		    ops[i].size);
+	else
+	    fprintf(fp, "%c %d %d", ops[i].type, newid[ops[i].id],
+		    ops[i].size);
+	fprintf(fp, "%s%s\n", ops[i].tags[0] ? " " : "", ops[i].tags);
+    }
+    fclose(fp);
+    free(newid);
+}
+
+/*
+ * error_class - reduce a malloc_error message to its class by dropping
+ *     the parenthesized addresses and all digits
+ */
+static void error_class(char *msg, char *class)
+{
+    int depth = 0;
+    char *q = class;
+
+    for (; *msg && *msg != '\n'; msg++) {
+	if (*msg == '(')
+	    depth++;
+	else if (*msg == ')' && depth > 0)
+	    depth--;
+	else if (depth == 0 && !isdigit((unsigned char)*msg) &&
+		 !(*msg == ' ' && (q == class || q[-1] == ' ')))
+	    *q++ = *msg;
+    }
+    while (q > class && (q[-1] == ' ' || q[-1] == '.'))
+	q--;
+    *q = '\0';
+}
+
+/*
+ * run_driver - run mdriver on the candidate trace and store the class
+ *     of its failure in class (the empty string if it did not fail)
+ */
+static void run_driver(char *sel, char *class)
+{
+    char *argv[MAXARGS + 4], line[MAXLINE], *p;
+    int fd[2], i, status;
+    pid_t pid;
+    FILE *out;
+
+    write_trace(tmpname, sel);
+    runs++;
+
+    argv[0] = mdriver;
+    for (i = 0; i < num_driver_args; i++)
+	argv[i + 1] = driver_args[i];
+    argv[i + 1] = "-f";
+    argv[i + 2] = tmpname;
+    argv[i + 3] = NULL;
+
+    if (pipe(fd) < 0)
+	app_error("pipe failed", NULL);
+    if ((pid = fork()) < 0)
+	app_error("fork failed", NULL);
+    if (pid == 0) {
+	/* the driver: stdout to us, stderr discarded, killed on a hang */
+	dup2(fd[1], 1);
+	close(fd[0]);
+	close(fd[1]);
+	if (freopen("/dev/null", "w", stderr) == NULL)
+	    _exit(127);
+	alarm(timeout);
+	execv(mdriver, argv);
+	_exit(127);
+    }
+
+    close(fd[1]);
+    class[0] = '\0';
+    if ((out = fdopen(fd[0], "r")) == NULL)
+	app_error("fdopen failed", NULL);
+    while (fgets(line, MAXLINE, out) != NULL) {
+	if (class[0] || strncmp(line, "ERROR [trace", 12))
+	    continue;
+	if ((p = strstr(line, "]: ")) != NULL)
+	    error_class(p + 3, class);
+    }
+    fclose(out);
+    waitpid(pid, &status, 0);
+
+    if (class[0])
+	return;
+    if (WIFSIGNALED(status)) {
+	if (WTERMSIG(status) == SIGALRM)
+	    strcpy(class, "timeout");
+	else
+	    sprintf(class, "crash (%s)", strsignal(WTERMSIG(status)));
+    }
+    else if (WIFEXITED(status) && WEXITSTATUS(status) == 127)
+	app_error("could not run ", mdriver);
+}
+
+/*
+ * reproduces - does the trace made of the ops in sel fail like the
+ *     original one?
+ */
+static int reproduces(char *sel)
+{
+    char class[MAXLINE];
+
+    if (!well_formed(sel))
+	return 0;
+    run_driver(sel, class);
+    return !strcmp(class, target);
+}
+
+/*
+ * ddmin - delta-debug the units of a trace: unit[i] is the unit that
+ *     op i belongs to, or -1 if op i is not removable in this pass.
+ *     Tries to drop ever smaller groups of units from keep while the
+ *     trace still fails the same way. Returns the number of units dropped.
+ */
+static int ddmin(int *unit, int nunits)
+{
+    int *alive, *tmp;
+    char *drop, *cand;
+    int nalive, n, chunk, start, end, i, dropped = 0;
+
+    alive = malloc(nunits * sizeof(int));
+    tmp = malloc(nunits * sizeof(int));
+    drop = calloc(nunits, 1);
+    cand = malloc(num_ops);
+    if (!alive || !tmp || !drop || !cand)
+	app_error("out of memory", NULL);
+
+    /* only units that still have ops in the trace take part */
+    nalive = 0;
+    for (i = 0; i < num_ops; i++)
+	if (keep[i] && unit[i] >= 0 && !drop[unit[i]]) {
+	    drop[unit[i]] = 1;
+	    alive[nalive++] = unit[i];
+	}
+    memset(drop, 0, nunits);
+
+    n = 2;
+    while (nalive > 0) {
+	if (n > nalive)
+	    n = nalive;
+	chunk = (nalive + n - 1) / n;
+
+	/* try to remove each chunk of units in turn */
+	for (start = 0; start < nalive; start += chunk) {
+	    end = start + chunk < nalive ? start + chunk : nalive;
+	    for (i = start; i < end; i++)
+		drop[alive[i]] = 1;
+	    for (i = 0; i < num_ops; i++)
+		cand[i] = keep[i] && !(unit[i] >= 0 && drop[unit[i]]);
+	    for (i = start; i < end; i++)
+		drop[alive[i]] = 0;
+	    if (reproduces(cand))
+		break;
+	}
+
+	if (start < nalive) {
+	    /* success: continue with the complement */
+	    memcpy(keep, cand, num_ops);
+	    dropped += end - start;
+	    memcpy(tmp, alive, start * sizeof(int));
+	    memcpy(tmp + start, alive + end, (nalive - end) * sizeof(int));
+	    memcpy(alive, tmp, (nalive - (end - start)) * sizeof(int));
+	    nalive -= end - start;
+	    n = n > 2 ? n - 1 : 2;
+	    fprintf(stderr, "\r%d units left, %d runs   ", nalive, runs);
+	}
+	else if (n >= nalive)
+	    break;  /* single units cannot be removed */
+	else
+	    n = 2 * n;
+    }
+
+    free(alive);
+    free(tmp);
+    free(drop);
+    free(cand);
+    return dropped;
+}
+
+/*
+ * usage - explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: traceshrink [-h] [-m <mdriver>] [-a <args>] "
+	    "[-s <secs>] [-o <out>] <trace>\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-a <args>     Extra mdriver arguments, e.g. \"-L ./my.so\".\n");
+    fprintf(stderr, "\t-h            Print this message.\n");
+    fprintf(stderr, "\t-m <mdriver>  Driver to run (default ./mdriver).\n");
+    fprintf(stderr, "\t-o <out>      Write the shrunk trace to <out> "
+	    "(default <trace>.min).\n");
+    fprintf(stderr, "\t-s <secs>     Count a run longer than <secs> as a "
+	    "hang (default 60).\n");
+}
+
+int main(int argc, char **argv)
+{
+    char *outname = NULL, *args, *tok;
+    int *unit;
+    int c, i, n, removed;
+
+    while ((c = getopt(argc, argv, "m:a:s:o:h")) != EOF) {
+	switch (c) {
+	case 'm':
+	    mdriver = optarg;
+	    break;
+	case 'a':
+	    if ((args = strdup(optarg)) == NULL)
+		app_error("out of memory", NULL);
+	    for (tok = strtok(args, " "); tok; tok = strtok(NULL, " ")) {
+		if (num_driver_args == MAXARGS)
+		    app_error("too many driver arguments", NULL);
+		driver_args[num_driver_args++] = tok;
+	    }
+	    break;
+	case 's':
+	    timeout = atoi(optarg);
+	    if (timeout < 1)
+		app_error("-s expects a positive number of seconds", NULL);
+	    break;
+	case 'o':
+	    outname = optarg;
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (argc - optind != 1) {
+	usage();
+	exit(1);
+    }
+    if (outname == NULL) {
+	if ((outname = malloc(strlen(argv[optind]) + 5)) == NULL)
+	    app_error("out of memory", NULL);
+	sprintf(outname, "%s.min", argv[optind]);
+    }
+    /* mdriver -f reads traces relative to the current directory */
+    sprintf(tmpname, "traceshrink-%d.rep", (int)getpid());
+
+    read_trace(argv[optind]);
+    if ((keep = malloc(num_ops)) == NULL ||
+	(unit = malloc(num_ops * sizeof(int))) == NULL)
+	app_error("out of memory", NULL);
+    memset(keep, 1, num_ops);
+    if (!well_formed(keep))
+	app_error("the trace is not well-formed: ", argv[optind]);
+
+    run_driver(keep, target);
+    if (target[0] == '\0')
+	app_error("the trace does not fail: ", argv[optind]);
+    printf("Failure: %s\n", target);
+    fflush(stdout);
+
+    /* alternate between whole lifecycles and single requests */
+    do {
+	removed = 0;
+	for (i = 0; i < num_ops; i++)
+	    unit[i] = ops[i].id;
+	removed += ddmin(unit, num_ids);
+	for (i = 0; i < num_ops; i++)
+	    unit[i] = (ops[i].type == 'a' || ops[i].type == 'm') ? -1 : i;
+	removed += ddmin(unit, num_ops);
+    } while (removed > 0);
+    fprintf(stderr, "\n");
+
+    write_trace(outname, keep);
+    unlink(tmpname);
+    for (n = 0, i = 0; i < num_ops; i++)
+	n += keep[i];
+    printf("Shrunk %d ops to %d in %d mdriver runs, written to %s\n",
+	   num_ops, n, runs, outname);
+    return 0;
+}